@@ -0,0 +1,198 @@
+/**
+ * @file CbsHeaders.c
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#include "CbsHeaders.h"
+
+#include <libavcodec/cbs.h>
+#include <libavcodec/cbs_av1.h>
+#include <libavcodec/cbs_h264.h>
+#include <libavcodec/cbs_h265.h>
+#include <libavcodec/cbs_vp9.h>
+#include <libavutil/macros.h>
+#include <libavutil/mem.h>
+
+struct VideoParserCbsHeaders {
+  enum AVCodecID codec_id;
+  CodedBitstreamContext *cbc;
+  CodedBitstreamFragment fragment;
+};
+
+// only these units are decomposed; slice and tile data stay unparsed
+static const CodedBitstreamUnitType h264_units[] = {
+    H264_NAL_SPS, H264_NAL_PPS, H264_NAL_SLICE, H264_NAL_IDR_SLICE};
+static const CodedBitstreamUnitType h265_units[] = {
+    HEVC_NAL_VPS,        HEVC_NAL_SPS,        HEVC_NAL_PPS,
+    HEVC_NAL_TRAIL_N,    HEVC_NAL_TRAIL_R,    HEVC_NAL_TSA_N,
+    HEVC_NAL_TSA_R,      HEVC_NAL_STSA_N,     HEVC_NAL_STSA_R,
+    HEVC_NAL_RADL_N,     HEVC_NAL_RADL_R,     HEVC_NAL_RASL_N,
+    HEVC_NAL_RASL_R,     HEVC_NAL_BLA_W_LP,   HEVC_NAL_BLA_W_RADL,
+    HEVC_NAL_BLA_N_LP,   HEVC_NAL_IDR_W_RADL, HEVC_NAL_IDR_N_LP,
+    HEVC_NAL_CRA_NUT};
+static const CodedBitstreamUnitType av1_units[] = {
+    AV1_OBU_SEQUENCE_HEADER, AV1_OBU_FRAME_HEADER, AV1_OBU_FRAME};
+
+VideoParserCbsHeaders *
+videoparser_cbs_headers_open(const AVCodecParameters *par) {
+  VideoParserCbsHeaders *reader;
+
+  if (par->codec_id != AV_CODEC_ID_H264 && par->codec_id != AV_CODEC_ID_HEVC &&
+      par->codec_id != AV_CODEC_ID_VP9 && par->codec_id != AV_CODEC_ID_AV1) {
+    return NULL;
+  }
+
+  reader = av_mallocz(sizeof(*reader));
+  if (!reader) {
+    return NULL;
+  }
+  reader->codec_id = par->codec_id;
+  if (ff_cbs_init(&reader->cbc, par->codec_id, NULL) < 0) {
+    av_free(reader);
+    return NULL;
+  }
+
+  switch (par->codec_id) {
+  case AV_CODEC_ID_H264:
+    reader->cbc->decompose_unit_types = h264_units;
+    reader->cbc->nb_decompose_unit_types = FF_ARRAY_ELEMS(h264_units);
+    break;
+  case AV_CODEC_ID_HEVC:
+    reader->cbc->decompose_unit_types = h265_units;
+    reader->cbc->nb_decompose_unit_types = FF_ARRAY_ELEMS(h265_units);
+    break;
+  case AV_CODEC_ID_AV1:
+    reader->cbc->decompose_unit_types = av1_units;
+    reader->cbc->nb_decompose_unit_types = FF_ARRAY_ELEMS(av1_units);
+    break;
+  default:
+    break; // VP9 has only one unit type, the frame
+  }
+
+  // parameter sets of MP4/Matroska streams
+  if (par->extradata_size > 0) {
+    if (ff_cbs_read_extradata(reader->cbc, &reader->fragment, par) < 0) {
+      videoparser_cbs_headers_close(&reader);
+      return NULL;
+    }
+    ff_cbs_fragment_reset(&reader->fragment);
+  }
+  return reader;
+}
+
+static int unit_qp(const VideoParserCbsHeaders *reader,
+                   const CodedBitstreamUnit *unit, int *qp_init,
+                   int *is_shown) {
+  if (!unit->content) {
+    return 0;
+  }
+  *is_shown = 1;
+
+  switch (reader->codec_id) {
+  case AV_CODEC_ID_H264: {
+    const CodedBitstreamH264Context *h264 = reader->cbc->priv_data;
+    const H264RawSlice *slice = unit->content;
+    const H264RawPPS *pps;
+    if (unit->type != H264_NAL_SLICE && unit->type != H264_NAL_IDR_SLICE) {
+      return 0;
+    }
+    pps = h264->pps[slice->header.pic_parameter_set_id];
+    if (!pps) {
+      return 0;
+    }
+    *qp_init = 26 + pps->pic_init_qp_minus26 + slice->header.slice_qp_delta;
+    return 1;
+  }
+  case AV_CODEC_ID_HEVC: {
+    const CodedBitstreamH265Context *h265 = reader->cbc->priv_data;
+    const H265RawSlice *slice = unit->content;
+    const H265RawPPS *pps;
+    if (unit->type > HEVC_NAL_CRA_NUT) {
+      return 0;
+    }
+    // dependent slice segments inherit the QP of the independent one
+    if (slice->header.dependent_slice_segment_flag) {
+      return 0;
+    }
+    pps = h265->pps[slice->header.slice_pic_parameter_set_id];
+    if (!pps) {
+      return 0;
+    }
+    *qp_init = 26 + pps->init_qp_minus26 + slice->header.slice_qp_delta;
+    return 1;
+  }
+  case AV_CODEC_ID_VP9: {
+    const VP9RawFrame *frame = unit->content;
+    if (frame->header.show_existing_frame) {
+      return 0;
+    }
+    *qp_init = frame->header.base_q_idx;
+    *is_shown = frame->header.show_frame;
+    return 1;
+  }
+  case AV_CODEC_ID_AV1: {
+    const AV1RawOBU *obu = unit->content;
+    const AV1RawFrameHeader *header;
+    if (unit->type == AV1_OBU_FRAME) {
+      header = &obu->obu.frame.header;
+    } else if (unit->type == AV1_OBU_FRAME_HEADER) {
+      header = &obu->obu.frame_header;
+    } else {
+      return 0;
+    }
+    if (header->show_existing_frame) {
+      return 0;
+    }
+    *qp_init = header->base_q_idx;
+    *is_shown = header->show_frame;
+    return 1;
+  }
+  default:
+    return 0;
+  }
+}
+
+int videoparser_cbs_headers_read_qp(VideoParserCbsHeaders *reader,
+                                    const AVPacket *pkt, int *qp_init) {
+  int ret;
+  int i;
+  int qp;
+  int is_shown;
+  int found = 0;
+
+  ret = ff_cbs_read_packet(reader->cbc, &reader->fragment, pkt);
+  if (ret < 0) {
+    ff_cbs_fragment_reset(&reader->fragment);
+    return ret;
+  }
+
+  // the QP of the first slice or frame header, which is what the decoder
+  // hooks report as qp_init; VP9 superframes and AV1 temporal units may start
+  // with hidden frames, but the decoder outputs the shown one
+  for (i = 0; i < reader->fragment.nb_units; i++) {
+    if (!unit_qp(reader, &reader->fragment.units[i], &qp, &is_shown)) {
+      continue;
+    }
+    if (!found || is_shown) {
+      *qp_init = qp;
+      found = 1;
+    }
+    if (is_shown) {
+      break;
+    }
+  }
+
+  ff_cbs_fragment_reset(&reader->fragment);
+  return found;
+}
+
+void videoparser_cbs_headers_close(VideoParserCbsHeaders **reader) {
+  if (!*reader) {
+    return;
+  }
+  ff_cbs_fragment_free(&(*reader)->fragment);
+  ff_cbs_close(&(*reader)->cbc);
+  av_freep(reader);
+}
@@ -0,0 +1,62 @@
+/**
+ * @file CbsHeaders.h
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#ifndef VIDEOPARSER_CBS_HEADERS_H
+#define VIDEOPARSER_CBS_HEADERS_H
+
+#include <libavcodec/codec_par.h>
+#include <libavcodec/packet.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Reads slice, frame and OBU headers with FFmpeg's coded bitstream
+ * (CBS) API, without decoding any block data.
+ *
+ * Implemented in C, since the CBS headers are internal to FFmpeg and not
+ * meant to be compiled as C++.
+ */
+typedef struct VideoParserCbsHeaders VideoParserCbsHeaders;
+
+/**
+ * @brief Open a header reader for a stream
+ *
+ * @param par The stream's codec parameters, for the codec and the extradata
+ * (parameter sets of H.264/HEVC in MP4)
+ * @return VideoParserCbsHeaders* The reader, or NULL if the codec is not
+ * supported or on error
+ */
+VideoParserCbsHeaders *
+videoparser_cbs_headers_open(const AVCodecParameters *par);
+
+/**
+ * @brief Read the headers of a packet and get the QP of its first slice or
+ * frame header: `26 + init_qp + slice_qp_delta` for H.264/HEVC, `base_q_idx`
+ * for VP9/AV1. For VP9/AV1, the first shown frame takes precedence over
+ * hidden ones.
+ *
+ * @param reader The reader
+ * @param pkt The packet, one access unit or temporal unit
+ * @param qp_init Set to the QP, if found
+ * @return int 1 if the QP was found, 0 if the packet has no slice or frame
+ * header, negative on error
+ */
+int videoparser_cbs_headers_read_qp(VideoParserCbsHeaders *reader,
+                                    const AVPacket *pkt, int *qp_init);
+
+/**
+ * @brief Close the reader and set the pointer to NULL
+ */
+void videoparser_cbs_headers_close(VideoParserCbsHeaders **reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // VIDEOPARSER_CBS_HEADERS_H
@@ -0,0 +1,131 @@
+/**
+ * @file GopSampling.cpp
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#include "GopSampling.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+
+namespace videoparser {
+
+SampleMethod sample_method_from_name(const std::string &name) {
+  if (name == "stratified") {
+    return SampleMethod::Stratified;
+  }
+  if (name == "random") {
+    return SampleMethod::Random;
+  }
+  throw std::runtime_error("Unknown sample method: " + name);
+}
+
+std::vector<uint64_t> sample_positions(uint64_t population, uint64_t count,
+                                       SampleMethod method, uint64_t seed) {
+  std::vector<uint64_t> positions;
+  if (count >= population) {
+    positions.resize(population);
+    std::iota(positions.begin(), positions.end(), 0);
+    return positions;
+  }
+
+  std::mt19937_64 generator(seed);
+  if (method == SampleMethod::Stratified) {
+    // stratum i is [i * population / count, (i + 1) * population / count),
+    // which holds at least one position
+    for (uint64_t i = 0; i < count; i++) {
+      uint64_t begin = i * population / count;
+      uint64_t end = (i + 1) * population / count;
+      std::uniform_int_distribution<uint64_t> in_stratum(begin, end - 1);
+      positions.push_back(in_stratum(generator));
+    }
+    return positions;
+  }
+
+  // Floyd's algorithm: count distinct positions without a population-sized
+  // array, since the population may be a duration in time base units
+  std::vector<uint64_t> chosen;
+  for (uint64_t j = population - count; j < population; j++) {
+    std::uniform_int_distribution<uint64_t> up_to_j(0, j);
+    uint64_t position = up_to_j(generator);
+    if (std::find(chosen.begin(), chosen.end(), position) != chosen.end()) {
+      position = j;
+    }
+    chosen.push_back(position);
+  }
+  std::sort(chosen.begin(), chosen.end());
+  return chosen;
+}
+
+GopSampleEstimator::GopSampleEstimator(size_t value_count)
+    : current_sums(value_count, 0.0) {}
+
+void GopSampleEstimator::end_gop() {
+  if (current_frame_count > 0) {
+    gops.push_back({current_frame_count, current_sums});
+  }
+  current_frame_count = 0;
+  std::fill(current_sums.begin(), current_sums.end(), 0.0);
+}
+
+MetricEstimate GopSampleEstimator::estimate(size_t value_idx,
+                                            uint64_t population) const {
+  MetricEstimate result{0.0, NAN, NAN};
+  if (gops.empty()) {
+    return result;
+  }
+
+  double frame_sum = 0;
+  double value_sum = 0;
+  for (const Gop &gop : gops) {
+    frame_sum += gop.frame_count;
+    value_sum += gop.sums[value_idx];
+  }
+  result.mean = value_sum / frame_sum;
+
+  uint64_t k = gops.size();
+  if (k < 2) {
+    return result;
+  }
+
+  double residual_sum_sqr = 0;
+  for (const Gop &gop : gops) {
+    double residual = gop.sums[value_idx] - result.mean * gop.frame_count;
+    residual_sum_sqr += residual * residual;
+  }
+  double mean_frames = frame_sum / k;
+  double sampled_fraction =
+      population > 0 ? std::min(1.0, static_cast<double>(k) / population) : 0;
+  double variance = (1 - sampled_fraction) * residual_sum_sqr / (k - 1) /
+                    (k * mean_frames * mean_frames);
+  double half_width = t_quantile(k - 1) * std::sqrt(variance);
+  result.ci_lower = result.mean - half_width;
+  result.ci_upper = result.mean + half_width;
+  return result;
+}
+
+double GopSampleEstimator::t_quantile(uint64_t dof) {
+  static const double table[] = {
+      12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+      2.201,  2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+      2.080,  2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+  if (dof == 0) {
+    throw std::runtime_error("Invalid degrees of freedom");
+  }
+  if (dof <= sizeof(table) / sizeof(table[0])) {
+    return table[dof - 1];
+  }
+  // Cornish-Fisher expansion around the normal quantile, accurate to 1e-3
+  // beyond the table
+  double z = 1.959964;
+  double n = static_cast<double>(dof);
+  return z + (z * z * z + z) / (4 * n) +
+         (5 * std::pow(z, 5) + 16 * z * z * z + 3 * z) / (96 * n * n);
+}
+
+} // namespace videoparser
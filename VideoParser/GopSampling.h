@@ -0,0 +1,136 @@
+/**
+ * @file GopSampling.h
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#ifndef VIDEOPARSER_GOP_SAMPLING_H
+#define VIDEOPARSER_GOP_SAMPLING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace videoparser {
+
+/**
+ * @brief How the GOPs are chosen for ParserOptions::sample_gops.
+ */
+enum class SampleMethod {
+  Stratified, /**< One GOP at a random position in each of K equal parts */
+  Random,     /**< K GOPs at random positions, without replacement */
+};
+
+/**
+ * @brief Get the sample method for a CLI name
+ *
+ * @param name "stratified" or "random"
+ * @return SampleMethod The sample method
+ * @throws std::runtime_error If the name is unknown
+ */
+SampleMethod sample_method_from_name(const std::string &name);
+
+/**
+ * @brief Choose distinct positions in `[0, population)`
+ *
+ * The same seed always gives the same positions.
+ *
+ * @param population Number of positions to choose from
+ * @param count Number of positions to choose; all positions if at least the
+ * population
+ * @param method How to choose the positions
+ * @param seed Seed of the random generator
+ * @return std::vector<uint64_t> The positions, in ascending order
+ */
+std::vector<uint64_t> sample_positions(uint64_t population, uint64_t count,
+                                       SampleMethod method, uint64_t seed);
+
+/**
+ * @brief An estimated per-frame mean, with its 95% confidence interval.
+ */
+struct MetricEstimate {
+  double mean;     /**< Estimated mean over all frames of the sequence */
+  double ci_lower; /**< Lower bound of the 95% confidence interval, NaN if
+                      fewer than two GOPs were sampled */
+  double ci_upper; /**< Upper bound of the 95% confidence interval, NaN if
+                      fewer than two GOPs were sampled */
+};
+
+/**
+ * @brief Estimates per-frame means from a sample of GOPs.
+ *
+ * The sampled GOPs are clusters of frames of different sizes, so the mean is
+ * the ratio estimator `sum(y_i) / sum(m_i)` over the sums `y_i` and frame
+ * counts `m_i` of the sampled GOPs, and its variance is
+ * `(1 - k/N) / (k * mean(m)^2) * sum((y_i - mean * m_i)^2) / (k - 1)` for `k`
+ * of `N` GOPs. The confidence interval uses Student's t-distribution with
+ * `k - 1` degrees of freedom. Consecutive frames within a GOP are strongly
+ * correlated, which this accounts for, unlike treating all sampled frames as
+ * independent.
+ */
+class GopSampleEstimator {
+public:
+  /**
+   * @brief Construct a new estimator
+   *
+   * @param value_count Number of values per frame
+   */
+  explicit GopSampleEstimator(size_t value_count);
+
+  /**
+   * @brief Add a value of the current frame to the current GOP
+   *
+   * @param value_idx Index of the value, in `[0, value_count)`
+   * @param value The value
+   */
+  void add_value(size_t value_idx, double value) {
+    current_sums[value_idx] += value;
+  }
+
+  /**
+   * @brief Count a frame of the current GOP, after adding its values
+   */
+  void add_frame() { current_frame_count++; }
+
+  /**
+   * @brief End the current GOP; GOPs without frames are ignored
+   */
+  void end_gop();
+
+  /**
+   * @brief Number of GOPs sampled so far
+   */
+  size_t gop_count() const { return gops.size(); }
+
+  /**
+   * @brief Estimate the mean of a value over all frames
+   *
+   * @param value_idx Index of the value
+   * @param population Total number of GOPs in the sequence, or 0 if unknown
+   * (no finite population correction)
+   * @return MetricEstimate The estimate
+   */
+  MetricEstimate estimate(size_t value_idx, uint64_t population) const;
+
+  /**
+   * @brief The 97.5% quantile of Student's t-distribution
+   *
+   * @param dof Degrees of freedom, at least 1
+   */
+  static double t_quantile(uint64_t dof);
+
+private:
+  struct Gop {
+    uint64_t frame_count;
+    std::vector<double> sums;
+  };
+  std::vector<Gop> gops;
+  uint64_t current_frame_count = 0;
+  std::vector<double> current_sums;
+};
+
+} // namespace videoparser
+
+#endif // VIDEOPARSER_GOP_SAMPLING_H
@@ -0,0 +1,519 @@
+/**
+ * @file Mp4SampleTable.cpp
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#include "Mp4SampleTable.h"
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <stdexcept>
+
+namespace videoparser {
+
+namespace {
+
+constexpr uint32_t box_type(const char (&name)[5]) {
+  return static_cast<uint32_t>(static_cast<uint8_t>(name[0])) << 24 |
+         static_cast<uint32_t>(static_cast<uint8_t>(name[1])) << 16 |
+         static_cast<uint32_t>(static_cast<uint8_t>(name[2])) << 8 |
+         static_cast<uint32_t>(static_cast<uint8_t>(name[3]));
+}
+
+// sample flags of trex, tfhd and trun (ISO/IEC 14496-12, 8.8.3.1), which
+// FFmpeg combines into the key frame flag in the same way
+constexpr uint32_t SAMPLE_DEPENDS_YES = 0x01000000;
+constexpr uint32_t SAMPLE_DEPENDS_NO = 0x02000000;
+constexpr uint32_t SAMPLE_IS_NON_SYNC = 0x00010000;
+
+// moov and moof boxes are read into memory; anything larger is not a header
+constexpr uint64_t MAX_HEADER_BOX_SIZE = 1ULL << 30;
+
+/**
+ * Reads big-endian values and child boxes from the payload of a box.
+ */
+class BoxReader {
+public:
+  BoxReader() = default;
+  BoxReader(const uint8_t *data, size_t size) : data(data), size(size) {}
+
+  size_t remaining() const { return size - pos; }
+
+  void skip(size_t count) {
+    check(count);
+    pos += count;
+  }
+
+  uint64_t read(int bytes) {
+    check(bytes);
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+      value = (value << 8) | data[pos++];
+    }
+    return value;
+  }
+
+  uint32_t u32() { return static_cast<uint32_t>(read(4)); }
+  uint64_t u64() { return read(8); }
+
+  // version and flags of a full box
+  uint8_t full_box(uint32_t &flags) {
+    uint32_t version_flags = u32();
+    flags = version_flags & 0xffffff;
+    return static_cast<uint8_t>(version_flags >> 24);
+  }
+
+  // the next child box, or false at the end of the payload
+  bool next_box(uint32_t &type, BoxReader &payload) {
+    if (remaining() < 8) {
+      return false;
+    }
+    uint64_t box_size = u32();
+    type = u32();
+    uint64_t header_size = 8;
+    if (box_size == 1) {
+      box_size = u64();
+      header_size = 16;
+    } else if (box_size == 0) {
+      box_size = remaining() + header_size;
+    }
+    if (box_size < header_size || box_size - header_size > remaining()) {
+      throw std::runtime_error("Error reading MP4 boxes: invalid box size");
+    }
+    payload = BoxReader(data + pos, box_size - header_size);
+    pos += box_size - header_size;
+    return true;
+  }
+
+private:
+  const uint8_t *data = nullptr;
+  size_t size = 0;
+  size_t pos = 0;
+
+  void check(size_t count) const {
+    if (count > size - pos) {
+      throw std::runtime_error("Error reading MP4 boxes: truncated box");
+    }
+  }
+};
+
+struct SampleDefaults {
+  uint32_t duration = 0;
+  uint32_t size = 0;
+  uint32_t flags = 0;
+};
+
+struct TrackBoxes {
+  uint32_t track_id = 0;
+  uint32_t timescale = 0;
+  bool is_video = false;
+  int64_t empty_edit_duration = 0; // in the movie timescale
+  int64_t media_time = -1;         // of the first edit that is not empty
+  uint32_t sample_size = 0;        // of all samples, or 0
+  uint32_t sample_count = 0;
+  std::vector<uint32_t> sizes;     // if sample_size is 0
+  std::vector<std::pair<uint32_t, uint32_t>> stts; // count, duration
+  std::vector<std::pair<uint32_t, int32_t>> ctts;  // count, offset
+  std::vector<uint32_t> sync_samples;              // one-based
+};
+
+// each table entry takes at least this many bytes, which bounds the count
+void check_count(const BoxReader &box, uint64_t count, size_t entry_size) {
+  if (count > box.remaining() / entry_size) {
+    throw std::runtime_error("Error reading MP4 boxes: invalid entry count");
+  }
+}
+
+void read_elst(BoxReader box, TrackBoxes &track) {
+  uint32_t flags;
+  uint8_t version = box.full_box(flags);
+  uint32_t count = box.u32();
+  for (uint32_t i = 0; i < count; i++) {
+    uint64_t duration = version == 1 ? box.u64() : box.u32();
+    int64_t media_time = version == 1
+                             ? static_cast<int64_t>(box.u64())
+                             : static_cast<int32_t>(box.u32());
+    box.skip(4); // media rate
+    if (media_time == -1) {
+      track.empty_edit_duration += duration;
+    } else {
+      track.media_time = media_time;
+      break;
+    }
+  }
+}
+
+void read_stbl(BoxReader stbl, TrackBoxes &track) {
+  uint32_t type;
+  BoxReader box;
+  uint32_t flags;
+  while (stbl.next_box(type, box)) {
+    if (type == box_type("stsz")) {
+      box.full_box(flags);
+      track.sample_size = box.u32();
+      track.sample_count = box.u32();
+      if (track.sample_size == 0) {
+        check_count(box, track.sample_count, 4);
+        for (uint32_t i = 0; i < track.sample_count; i++) {
+          track.sizes.push_back(box.u32());
+        }
+      }
+    } else if (type == box_type("stz2")) {
+      box.full_box(flags);
+      box.skip(3);
+      int field_size = static_cast<int>(box.read(1));
+      track.sample_count = box.u32();
+      if (field_size != 4 && field_size != 8 && field_size != 16) {
+        throw std::runtime_error("Error reading MP4 boxes: invalid stz2");
+      }
+      check_count(box, (uint64_t{track.sample_count} * field_size + 7) / 8,
+                  1);
+      for (uint32_t i = 0; i < track.sample_count; i++) {
+        if (field_size == 4) {
+          uint32_t pair = static_cast<uint32_t>(box.read(1));
+          track.sizes.push_back(pair >> 4);
+          if (++i < track.sample_count) {
+            track.sizes.push_back(pair & 0x0f);
+          }
+        } else {
+          track.sizes.push_back(
+              static_cast<uint32_t>(box.read(field_size / 8)));
+        }
+      }
+    } else if (type == box_type("stts")) {
+      box.full_box(flags);
+      uint32_t count = box.u32();
+      check_count(box, count, 8);
+      for (uint32_t i = 0; i < count; i++) {
+        uint32_t sample_count = box.u32();
+        track.stts.emplace_back(sample_count, box.u32());
+      }
+    } else if (type == box_type("ctts")) {
+      // version 0 offsets are unsigned, but FFmpeg reads both as signed
+      box.full_box(flags);
+      uint32_t count = box.u32();
+      check_count(box, count, 8);
+      for (uint32_t i = 0; i < count; i++) {
+        uint32_t sample_count = box.u32();
+        track.ctts.emplace_back(sample_count, static_cast<int32_t>(box.u32()));
+      }
+    } else if (type == box_type("stss") || type == box_type("stps")) {
+      // QuickTime's partial sync samples are key frames for FFmpeg, too
+      box.full_box(flags);
+      uint32_t count = box.u32();
+      check_count(box, count, 4);
+      for (uint32_t i = 0; i < count; i++) {
+        track.sync_samples.push_back(box.u32());
+      }
+    }
+  }
+}
+
+void read_trak(BoxReader trak, TrackBoxes &track) {
+  uint32_t type;
+  BoxReader box;
+  uint32_t flags;
+  while (trak.next_box(type, box)) {
+    if (type == box_type("tkhd")) {
+      uint8_t version = box.full_box(flags);
+      box.skip(version == 1 ? 16 : 8); // creation and modification time
+      track.track_id = box.u32();
+    } else if (type == box_type("mdhd")) {
+      uint8_t version = box.full_box(flags);
+      box.skip(version == 1 ? 16 : 8);
+      track.timescale = box.u32();
+    } else if (type == box_type("hdlr")) {
+      box.full_box(flags);
+      // QuickTime files also have a data handler in minf
+      box.skip(4); // pre_defined
+      if (box.u32() == box_type("vide")) {
+        track.is_video = true;
+      }
+    } else if (type == box_type("elst")) {
+      read_elst(box, track);
+    } else if (type == box_type("stbl")) {
+      read_stbl(box, track);
+    } else if (type == box_type("edts") || type == box_type("mdia") ||
+               type == box_type("minf")) {
+      read_trak(box, track);
+    }
+  }
+}
+
+/**
+ * Reads the moov box: the movie timescale, the track at track_index and the
+ * fragment defaults of all tracks. Returns false if there is no such track.
+ */
+bool read_moov(BoxReader moov, int track_index, uint32_t &movie_timescale,
+               TrackBoxes &track, std::map<uint32_t, SampleDefaults> &trex) {
+  uint32_t type;
+  BoxReader box;
+  uint32_t flags;
+  int trak_idx = 0;
+  bool has_track = false;
+  while (moov.next_box(type, box)) {
+    if (type == box_type("mvhd")) {
+      uint8_t version = box.full_box(flags);
+      box.skip(version == 1 ? 16 : 8);
+      movie_timescale = box.u32();
+    } else if (type == box_type("trak")) {
+      if (trak_idx++ == track_index) {
+        read_trak(box, track);
+        has_track = true;
+      }
+    } else if (type == box_type("mvex")) {
+      uint32_t mvex_type;
+      BoxReader mvex_box;
+      while (box.next_box(mvex_type, mvex_box)) {
+        if (mvex_type == box_type("trex")) {
+          mvex_box.full_box(flags);
+          uint32_t track_id = mvex_box.u32();
+          mvex_box.skip(4); // default_sample_description_index
+          SampleDefaults &defaults = trex[track_id];
+          defaults.duration = mvex_box.u32();
+          defaults.size = mvex_box.u32();
+          defaults.flags = mvex_box.u32();
+        }
+      }
+    }
+  }
+  return has_track;
+}
+
+/**
+ * A sample before the timestamps are shifted, with dts in the track
+ * timescale and the composition offset.
+ */
+struct RawSample {
+  int64_t dts;
+  int32_t cts_offset;
+  uint32_t size;
+  bool is_sync;
+};
+
+void read_trun(BoxReader trun, const SampleDefaults &defaults,
+               int64_t &decode_time, std::vector<RawSample> &samples) {
+  uint32_t flags;
+  trun.full_box(flags);
+  uint32_t count = trun.u32();
+  if (flags & 0x000001) {
+    trun.skip(4); // data_offset
+  }
+  bool has_first_flags = flags & 0x000004;
+  uint32_t first_flags = has_first_flags ? trun.u32() : 0;
+  size_t entry_size = ((flags & 0x000100) ? 4 : 0) +
+                      ((flags & 0x000200) ? 4 : 0) +
+                      ((flags & 0x000400) ? 4 : 0) +
+                      ((flags & 0x000800) ? 4 : 0);
+  if (entry_size > 0) {
+    check_count(trun, count, entry_size);
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    uint32_t duration = (flags & 0x000100) ? trun.u32() : defaults.duration;
+    uint32_t size = (flags & 0x000200) ? trun.u32() : defaults.size;
+    uint32_t sample_flags = (flags & 0x000400) ? trun.u32()
+                            : (i == 0 && has_first_flags) ? first_flags
+                                                          : defaults.flags;
+    int32_t cts_offset =
+        (flags & 0x000800) ? static_cast<int32_t>(trun.u32()) : 0;
+    bool is_sync = (sample_flags & SAMPLE_DEPENDS_NO) ||
+                   !(sample_flags & (SAMPLE_IS_NON_SYNC | SAMPLE_DEPENDS_YES));
+    samples.push_back({decode_time, cts_offset, size, is_sync});
+    decode_time += duration;
+  }
+}
+
+void read_moof(BoxReader moof, uint32_t track_id,
+               const SampleDefaults &track_defaults, int64_t &decode_time,
+               std::vector<RawSample> &samples) {
+  uint32_t type;
+  BoxReader traf;
+  uint32_t flags;
+  while (moof.next_box(type, traf)) {
+    if (type != box_type("traf")) {
+      continue;
+    }
+    SampleDefaults defaults = track_defaults;
+    bool is_track = false;
+    uint32_t traf_type;
+    BoxReader box;
+    while (traf.next_box(traf_type, box)) {
+      if (traf_type == box_type("tfhd")) {
+        box.full_box(flags);
+        is_track = box.u32() == track_id;
+        if (flags & 0x000001) {
+          box.skip(8); // base_data_offset
+        }
+        if (flags & 0x000002) {
+          box.skip(4); // sample_description_index
+        }
+        if (flags & 0x000008) {
+          defaults.duration = box.u32();
+        }
+        if (flags & 0x000010) {
+          defaults.size = box.u32();
+        }
+        if (flags & 0x000020) {
+          defaults.flags = box.u32();
+        }
+      } else if (!is_track) {
+        // tfhd comes first
+        break;
+      } else if (traf_type == box_type("tfdt")) {
+        uint8_t version = box.full_box(flags);
+        decode_time = static_cast<int64_t>(version == 1 ? box.u64()
+                                                        : box.u32());
+      } else if (traf_type == box_type("trun")) {
+        read_trun(box, defaults, decode_time, samples);
+      }
+    }
+  }
+}
+
+} // namespace
+
+std::optional<Mp4SampleTable> Mp4SampleTable::read(const std::string &filename,
+                                                   int track_index) {
+  std::ifstream file(filename, std::ios::binary);
+  if (!file) {
+    return std::nullopt;
+  }
+  file.seekg(0, std::ios::end);
+  uint64_t file_size = static_cast<uint64_t>(file.tellg());
+
+  uint32_t movie_timescale = 0;
+  TrackBoxes track;
+  std::map<uint32_t, SampleDefaults> trex;
+  bool has_moov = false;
+  bool has_track = false;
+  std::vector<RawSample> fragment_samples;
+  int64_t decode_time = 0;
+
+  // only the top-level box headers are read, except for moov and moof
+  uint64_t pos = 0;
+  while (pos + 8 <= file_size) {
+    uint8_t header[16];
+    file.seekg(static_cast<std::streamoff>(pos));
+    file.read(reinterpret_cast<char *>(header), 8);
+    BoxReader header_reader(header, 8);
+    uint64_t box_size = header_reader.u32();
+    uint32_t type = header_reader.u32();
+    uint64_t header_size = 8;
+    if (box_size == 1) {
+      file.read(reinterpret_cast<char *>(header + 8), 8);
+      box_size = BoxReader(header + 8, 8).u64();
+      header_size = 16;
+    } else if (box_size == 0) {
+      box_size = file_size - pos;
+    }
+    if (!file || box_size < header_size || box_size > file_size - pos) {
+      // e.g. an mdat that was cut off after the moov box
+      if (has_moov) {
+        break;
+      }
+      throw std::runtime_error("Error reading MP4 boxes: invalid box size");
+    }
+
+    bool is_moov = type == box_type("moov");
+    bool is_moof = type == box_type("moof") && has_track;
+    if (is_moov || is_moof) {
+      uint64_t payload_size = box_size - header_size;
+      if (payload_size > MAX_HEADER_BOX_SIZE) {
+        throw std::runtime_error("Error reading MP4 boxes: box too large");
+      }
+      std::vector<uint8_t> payload(payload_size);
+      file.read(reinterpret_cast<char *>(payload.data()), payload_size);
+      if (!file) {
+        throw std::runtime_error("Error reading MP4 boxes: truncated box");
+      }
+      BoxReader reader(payload.data(), payload.size());
+      if (is_moov) {
+        has_moov = true;
+        has_track =
+            read_moov(reader, track_index, movie_timescale, track, trex);
+        if (!has_track) {
+          break;
+        }
+        // fragments without a tfdt box continue after the moov samples
+        for (const auto &[sample_count, duration] : track.stts) {
+          decode_time += int64_t{sample_count} * duration;
+        }
+      } else {
+        read_moof(reader, track.track_id, trex[track.track_id], decode_time,
+                  fragment_samples);
+      }
+    }
+    pos += box_size;
+  }
+
+  if (!has_track || !track.is_video || track.timescale == 0) {
+    return std::nullopt;
+  }
+
+  // the sample tables of the moov box; the samples have to fit into the file,
+  // which bounds a sample count with a constant size
+  size_t count = track.sample_count;
+  if (track.sample_size > 0 &&
+      uint64_t{track.sample_size} * count > file_size) {
+    throw std::runtime_error("Error reading MP4 boxes: invalid sample count");
+  }
+  std::vector<RawSample> samples;
+  samples.reserve(count + fragment_samples.size());
+  int64_t dts = 0;
+  for (const auto &[sample_count, duration] : track.stts) {
+    for (uint32_t i = 0; i < sample_count && samples.size() < count; i++) {
+      uint32_t size = track.sample_size > 0 ? track.sample_size
+                                            : track.sizes[samples.size()];
+      samples.push_back({dts, 0, size, track.sync_samples.empty()});
+      dts += duration;
+    }
+  }
+  if (samples.size() < count) {
+    throw std::runtime_error("Error reading MP4 boxes: stts does not cover "
+                             "all samples");
+  }
+  size_t sample_idx = 0;
+  for (const auto &[sample_count, offset] : track.ctts) {
+    for (uint32_t i = 0; i < sample_count && sample_idx < count; i++) {
+      samples[sample_idx++].cts_offset = offset;
+    }
+  }
+  for (uint32_t sample_number : track.sync_samples) {
+    if (sample_number >= 1 && sample_number <= count) {
+      samples[sample_number - 1].is_sync = true;
+    }
+  }
+  // FFmpeg's MOV demuxer delays the decoding timestamps by the largest
+  // negative composition offset of ctts, except for its last two entries
+  int64_t dts_shift = 0;
+  for (size_t i = 0; i + 2 < track.ctts.size(); i++) {
+    dts_shift = std::max<int64_t>(dts_shift, -track.ctts[i].second);
+  }
+  // and the first edit maps its media time to the end of the empty edits
+  int64_t edit_shift = 0;
+  if (movie_timescale > 0) {
+    edit_shift = track.empty_edit_duration * track.timescale / movie_timescale;
+  }
+  if (track.media_time > 0) {
+    edit_shift -= track.media_time;
+  }
+
+  Mp4SampleTable table;
+  table.timescale = track.timescale;
+  table.has_fragments = !fragment_samples.empty();
+  samples.insert(samples.end(), fragment_samples.begin(),
+                 fragment_samples.end());
+  table.samples.reserve(samples.size());
+  for (const RawSample &sample : samples) {
+    table.samples.push_back({sample.dts + edit_shift - dts_shift,
+                             sample.dts + sample.cts_offset + edit_shift,
+                             sample.size, sample.is_sync});
+  }
+  return table;
+}
+
+} // namespace videoparser
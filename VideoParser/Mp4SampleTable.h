@@ -0,0 +1,80 @@
+/**
+ * @file Mp4SampleTable.h
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#ifndef VIDEOPARSER_MP4_SAMPLE_TABLE_H
+#define VIDEOPARSER_MP4_SAMPLE_TABLE_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace videoparser {
+
+/**
+ * @brief A sample of an MP4 track, as listed in its sample table.
+ */
+struct Mp4Sample {
+  int64_t dts;   /**< Decoding timestamp in the track timescale */
+  int64_t pts;   /**< Presentation timestamp in the track timescale */
+  uint32_t size; /**< Sample size in bytes */
+  bool is_sync;  /**< Whether the sample is a sync sample (key frame) */
+};
+
+/**
+ * @brief The samples of a track of an MP4/MOV file, read from its boxes
+ * without reading the media data.
+ *
+ * The samples come from the sample tables of the `moov` box (`stsz`/`stz2`,
+ * `stts`, `ctts` and `stss`) and, for fragmented files, from the `trun` boxes
+ * of all `moof` boxes, with the defaults of `trex` and `tfhd`. Only the box
+ * headers of the `mdat` boxes are read. The timestamps are shifted like
+ * FFmpeg's MOV demuxer does: by the first edit of the `elst` box, and the
+ * decoding timestamps by the largest negative composition offset, so that
+ * they match the packets of the demuxer for the common edit lists.
+ */
+class Mp4SampleTable {
+public:
+  /**
+   * @brief Read the sample table of a track
+   *
+   * @param filename The MP4/MOV file
+   * @param track_index Zero-based position of the track's `trak` box in the
+   * `moov` box, which is the stream index of FFmpeg's MOV demuxer
+   * @return std::optional<Mp4SampleTable> The sample table, or nothing if the
+   * file cannot be opened, has no `moov` box or the track is not a video track
+   * @throws std::runtime_error If a box is invalid or truncated
+   */
+  static std::optional<Mp4SampleTable> read(const std::string &filename,
+                                            int track_index);
+
+  /**
+   * @brief The samples, in decoding order
+   */
+  const std::vector<Mp4Sample> &get_samples() const { return samples; }
+
+  /**
+   * @brief The timescale of the track (`mdhd`), in units per second
+   */
+  uint32_t get_timescale() const { return timescale; }
+
+  /**
+   * @brief Whether any samples came from movie fragments
+   */
+  bool is_fragmented() const { return has_fragments; }
+
+private:
+  Mp4SampleTable() = default;
+
+  std::vector<Mp4Sample> samples;
+  uint32_t timescale = 0;
+  bool has_fragments = false;
+};
+
+} // namespace videoparser
+
+#endif // VIDEOPARSER_MP4_SAMPLE_TABLE_H
@@ -0,0 +1,272 @@
+/**
+ * @file OutputWriter.cpp
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#include "OutputWriter.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <zlib.h>
+
+namespace videoparser {
+
+namespace {
+
+/**
+ * @brief Writes uncompressed output to a file or STDOUT.
+ */
+class FileOutputWriter : public OutputWriter {
+public:
+  FileOutputWriter(const std::string &path) {
+    if (path == "-") {
+      file = stdout;
+      owns_file = false;
+    } else {
+      file = fopen(path.c_str(), "wb");
+      if (!file) {
+        throw std::runtime_error("Error opening output file " + path);
+      }
+    }
+  }
+
+  ~FileOutputWriter() override {
+    try {
+      close();
+    } catch (...) {
+    }
+  }
+
+  void write(const char *data, size_t size) override {
+    if (!file) {
+      throw std::runtime_error("Error writing to closed output");
+    }
+    if (fwrite(data, 1, size, file) != size) {
+      throw std::runtime_error("Error writing output");
+    }
+  }
+
+  void close() override {
+    if (!file) {
+      return;
+    }
+    FILE *to_close = file;
+    file = nullptr;
+    if (owns_file ? fclose(to_close) != 0 : fflush(to_close) != 0) {
+      throw std::runtime_error("Error closing output");
+    }
+  }
+
+private:
+  FILE *file = nullptr;
+  bool owns_file = true;
+};
+
+/**
+ * @brief Writes gzip-compressed output, deflating on a background thread.
+ *
+ * Data is collected into blocks of block_size bytes. Full blocks are handed to
+ * the compressor thread through a bounded queue, so memory use stays at most
+ * (max_queued_blocks + 1) blocks even if the disk is slower than the parser.
+ */
+class GzipOutputWriter : public OutputWriter {
+public:
+  static constexpr size_t block_size = 1 << 20;
+  static constexpr size_t max_queued_blocks = 4;
+
+  GzipOutputWriter(const std::string &path) {
+    file = fopen(path.c_str(), "wb");
+    if (!file) {
+      throw std::runtime_error("Error opening output file " + path);
+    }
+
+    // windowBits 15 + 16 selects the gzip wrapper instead of zlib
+    if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) != Z_OK) {
+      fclose(file);
+      throw std::runtime_error("Error initializing gzip compression");
+    }
+
+    current.reserve(block_size);
+    worker = std::thread(&GzipOutputWriter::compress_loop, this);
+  }
+
+  ~GzipOutputWriter() override {
+    // errors are only reported by an explicit close()
+    try {
+      close();
+    } catch (...) {
+    }
+    if (worker.joinable()) {
+      shutdown();
+    }
+  }
+
+  void write(const char *data, size_t size) override {
+    if (closed) {
+      throw std::runtime_error("Error writing to closed output");
+    }
+    while (size > 0) {
+      size_t n = std::min(size, block_size - current.size());
+      current.insert(current.end(), data, data + n);
+      data += n;
+      size -= n;
+      if (current.size() == block_size) {
+        submit_block();
+      }
+    }
+  }
+
+  void close() override {
+    if (closed) {
+      return;
+    }
+
+    // the worker must be joined even if the last block cannot be submitted
+    try {
+      if (!current.empty()) {
+        submit_block();
+      }
+    } catch (...) {
+      shutdown();
+      throw;
+    }
+    bool close_failed = !shutdown();
+
+    if (!error.empty()) {
+      throw std::runtime_error(error);
+    }
+    if (close_failed) {
+      throw std::runtime_error("Error closing gzip output");
+    }
+  }
+
+private:
+  FILE *file = nullptr;
+  z_stream stream = {};
+  std::thread worker;
+  std::mutex mutex;
+  std::condition_variable queue_changed;
+  std::deque<std::vector<char>> queue;
+  std::vector<char> current;
+  std::string error; // set by the worker, guarded by mutex
+  bool finished = false;
+  bool closed = false;
+
+  /**
+   * @brief Stops the worker, then releases the stream and the file.
+   *
+   * @return false if closing the file failed
+   */
+  bool shutdown() {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      finished = true;
+    }
+    queue_changed.notify_all();
+    worker.join();
+
+    deflateEnd(&stream);
+    bool close_ok = fclose(file) == 0;
+    file = nullptr;
+    closed = true;
+    return close_ok;
+  }
+
+  void submit_block() {
+    std::unique_lock<std::mutex> lock(mutex);
+    queue_changed.wait(lock, [this] {
+      return queue.size() < max_queued_blocks || !error.empty();
+    });
+    if (!error.empty()) {
+      throw std::runtime_error(error);
+    }
+    queue.push_back(std::move(current));
+    lock.unlock();
+    queue_changed.notify_all();
+
+    current = std::vector<char>();
+    current.reserve(block_size);
+  }
+
+  void compress_loop() {
+    std::vector<unsigned char> out(block_size);
+    while (true) {
+      std::vector<char> block;
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        queue_changed.wait(lock, [this] { return !queue.empty() || finished; });
+        if (queue.empty()) {
+          break;
+        }
+        block = std::move(queue.front());
+        queue.pop_front();
+      }
+      queue_changed.notify_all();
+
+      if (!deflate_block(block, Z_NO_FLUSH, out)) {
+        return;
+      }
+    }
+    deflate_block({}, Z_FINISH, out);
+  }
+
+  bool deflate_block(const std::vector<char> &block, int flush,
+                     std::vector<unsigned char> &out) {
+    stream.next_in =
+        reinterpret_cast<Bytef *>(const_cast<char *>(block.data()));
+    stream.avail_in = static_cast<uInt>(block.size());
+
+    int ret;
+    do {
+      stream.next_out = out.data();
+      stream.avail_out = static_cast<uInt>(out.size());
+      ret = deflate(&stream, flush);
+      if (ret == Z_STREAM_ERROR) {
+        set_error("Error compressing gzip output");
+        return false;
+      }
+      size_t have = out.size() - stream.avail_out;
+      if (have > 0 && fwrite(out.data(), 1, have, file) != have) {
+        set_error("Error writing gzip output");
+        return false;
+      }
+    } while (stream.avail_out == 0 ||
+             (flush == Z_FINISH && ret != Z_STREAM_END));
+
+    return true;
+  }
+
+  void set_error(const std::string &message) {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      error = message;
+      queue.clear();
+    }
+    queue_changed.notify_all();
+  }
+};
+
+bool ends_with(const std::string &str, const std::string &suffix) {
+  return str.size() >= suffix.size() &&
+         str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+} // namespace
+
+std::unique_ptr<OutputWriter> OutputWriter::open(const std::string &path) {
+  if (ends_with(path, ".gz")) {
+    return std::make_unique<GzipOutputWriter>(path);
+  }
+  return std::make_unique<FileOutputWriter>(path);
+}
+
+} // namespace videoparser
@@ -0,0 +1,71 @@
+/**
+ * @file OutputWriter.h
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#ifndef VIDEOPARSER_OUTPUT_WRITER_H
+#define VIDEOPARSER_OUTPUT_WRITER_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace videoparser {
+
+/**
+ * @brief Sink for serialized parser output.
+ *
+ * The CLI writes all records (line-delimited JSON or binary formats) through
+ * this interface, so the same serialization code can write to STDOUT, a plain
+ * file, or a gzip-compressed file. Use OutputWriter::open() to create the
+ * right implementation for a path.
+ */
+class OutputWriter {
+public:
+  virtual ~OutputWriter() = default;
+
+  /**
+   * @brief Write a chunk of data to the output
+   *
+   * @param data Pointer to the data
+   * @param size Number of bytes to write
+   * @throws std::runtime_error If the data cannot be written
+   */
+  virtual void write(const char *data, size_t size) = 0;
+
+  /**
+   * @brief Write a string to the output
+   *
+   * @param data The string to write
+   */
+  void write(const std::string &data) { write(data.data(), data.size()); }
+
+  /**
+   * @brief Flush all pending data and close the output
+   *
+   * Must be called before the writer is destroyed, otherwise errors that occur
+   * while flushing cannot be reported. Calling it more than once is a no-op.
+   *
+   * @throws std::runtime_error If the remaining data cannot be written
+   */
+  virtual void close() = 0;
+
+  /**
+   * @brief Open an output writer for a path
+   *
+   * A path of "-" writes to STDOUT. Paths ending in ".gz" are written
+   * gzip-compressed; compression happens on a separate thread in large blocks,
+   * so the parse loop is not slowed down by deflate.
+   *
+   * @param path Output path, or "-" for STDOUT
+   * @return std::unique_ptr<OutputWriter> The writer
+   * @throws std::runtime_error If the file cannot be opened
+   */
+  static std::unique_ptr<OutputWriter> open(const std::string &path);
+};
+
+} // namespace videoparser
+
+#endif // VIDEOPARSER_OUTPUT_WRITER_H
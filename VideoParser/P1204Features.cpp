@@ -0,0 +1,145 @@
+/**
+ * @file P1204Features.cpp
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#include "P1204Features.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace videoparser {
+
+// legacy per-frame column names, see test/compare_parsers.py
+static const std::pair<const char *, const char *> legacy_columns[] = {
+    {"Av_QP", "qp_avg"},
+    {"StdDev_QP", "qp_stdev"},
+    {"Av_QPBB", "qp_bb_avg"},
+    {"StdDev_QPBB", "qp_bb_stdev"},
+    {"min_QP", "qp_min"},
+    {"max_QP", "qp_max"},
+    {"InitialQP", "qp_init"},
+    {"Av_Motion", "motion_avg"},
+    {"StdDev_Motion", "motion_stdev"},
+    {"Av_MotionX", "motion_x_avg"},
+    {"StdDev_MotionX", "motion_x_stdev"},
+    {"Av_MotionY", "motion_y_avg"},
+    {"StdDev_MotionY", "motion_y_stdev"},
+    {"Av_MotionDif", "motion_diff_avg"},
+    {"StdDev_MotionDif", "motion_diff_stdev"},
+    {"BitCntMotion", "motion_bit_count"},
+    {"BitCntCoefs", "coefs_bit_count"},
+    {"NumBlksMv", "mb_mv_count"},
+    {"CodedMv", "mv_coded_count"},
+    {"FrameSize", "size"},
+};
+
+static const FrameInfoField &find_field(const char *name) {
+  for (const auto &field : frame_info_fields()) {
+    if (strcmp(field.name, name) == 0) {
+      return field;
+    }
+  }
+  throw std::runtime_error(std::string("Unknown frame info field: ") + name);
+}
+
+// maximum QP of the codec, to normalize QP values to [0, 1]
+static double max_qp(const char *codec) {
+  if (strcmp(codec, "h264") == 0 || strcmp(codec, "hevc") == 0) {
+    return 51.0;
+  }
+  return 255.0; // vp9, av1
+}
+
+// percentile with linear interpolation between the closest ranks, as
+// numpy.percentile() and scipy.stats.iqr() compute it by default
+static double percentile(const std::vector<double> &sorted, double q) {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  double rank = q * static_cast<double>(sorted.size() - 1);
+  size_t lower = static_cast<size_t>(rank);
+  size_t upper = std::min(lower + 1, sorted.size() - 1);
+  return sorted[lower] +
+         (rank - static_cast<double>(lower)) * (sorted[upper] - sorted[lower]);
+}
+
+static double interquartile_range(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  return percentile(values, 0.75) - percentile(values, 0.25);
+}
+
+static void
+add_statistics(std::vector<std::pair<std::string, double>> &values,
+               const std::string &column, const std::string &suffix,
+               const RunningStats &stats, std::vector<double> samples) {
+  values.emplace_back(column + "_mean" + suffix, stats.mean());
+  values.emplace_back(column + "_std" + suffix, stats.stdev());
+  values.emplace_back(column + "_min" + suffix, stats.min());
+  values.emplace_back(column + "_max" + suffix, stats.max());
+  values.emplace_back(column + "_skewness" + suffix, stats.skewness());
+  values.emplace_back(column + "_kurtosis" + suffix, stats.kurtosis());
+  values.emplace_back(column + "_iqr" + suffix,
+                      interquartile_range(std::move(samples)));
+}
+
+P1204FeatureExtractor::P1204FeatureExtractor() {
+  for (const auto &column : legacy_columns) {
+    columns.push_back({column.first, &find_field(column.second), RunningStats(),
+                       RunningStats(), {}});
+  }
+}
+
+void P1204FeatureExtractor::add_frame(const FrameInfo &frame_info) {
+  bool is_i = frame_info.frame_type == I;
+  is_i_frame.push_back(is_i);
+  for (auto &column : columns) {
+    double value = column.field->get(frame_info);
+    column.all_stats.add(value);
+    if (!is_i) {
+      column.non_i_stats.add(value);
+    }
+    column.values.push_back(value);
+  }
+}
+
+P1204Features
+P1204FeatureExtractor::get_features(const SequenceInfo &sequence_info) const {
+  P1204Features features;
+  features.codec = sequence_info.video_codec;
+
+  auto &values = features.values;
+  values.emplace_back("bitrate", sequence_info.video_bitrate);
+  values.emplace_back("framerate", sequence_info.video_framerate);
+  values.emplace_back("resolution", static_cast<double>(
+                                        sequence_info.video_width *
+                                        sequence_info.video_height));
+  values.emplace_back("bitdepth", sequence_info.video_bit_depth);
+  values.emplace_back("duration", sequence_info.video_duration);
+
+  // fall back to all frames for intra-only streams
+  const Column &qp = columns[0];
+  const RunningStats &qp_stats =
+      qp.non_i_stats.count() > 0 ? qp.non_i_stats : qp.all_stats;
+  values.emplace_back("quant",
+                      qp_stats.mean() / max_qp(sequence_info.video_codec));
+
+  for (const auto &column : columns) {
+    std::vector<double> non_i_values;
+    non_i_values.reserve(column.non_i_stats.count());
+    for (size_t i = 0; i < column.values.size(); i++) {
+      if (!is_i_frame[i]) {
+        non_i_values.push_back(column.values[i]);
+      }
+    }
+    add_statistics(values, column.name, "", column.all_stats, column.values);
+    add_statistics(values, column.name, "_non-i", column.non_i_stats,
+                   std::move(non_i_values));
+  }
+  return features;
+}
+
+} // namespace videoparser
@@ -0,0 +1,95 @@
+/**
+ * @file P1204Features.h
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#ifndef VIDEOPARSER_P1204_FEATURES_H
+#define VIDEOPARSER_P1204_FEATURES_H
+
+#include "Statistics.h"
+#include "VideoParser.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace videoparser {
+
+/**
+ * @brief Input features for the ITU-T P.1204.3 model.
+ */
+struct P1204Features {
+  std::string codec; /**< Codec name, as in SequenceInfo::video_codec */
+  /** Numeric features as (name, value) pairs, in output order */
+  std::vector<std::pair<std::string, double>> values;
+};
+
+/**
+ * @brief Computes the ITU-T P.1204.3 bitstream features in a single pass.
+ *
+ * The P.1204.3 reference implementation reads the per-frame statistics of the
+ * legacy parser and derives per-sequence features from them. This class
+ * computes per-sequence statistics of the same columns while parsing, from the
+ * FrameInfo stream:
+ *
+ * - sequence features: `bitrate` (kbps), `framerate`, `resolution` (pixels),
+ *   `bitdepth`, `duration` and `quant`, the mean QP of non-I frames normalized
+ *   by the codec's maximum QP
+ * - for every per-frame column, under its legacy name (e.g. `Av_QP`,
+ *   `FrameSize`): the `mean`, `std`, `min`, `max`, `skewness`, `kurtosis`
+ *   and `iqr` over all frames, and the same with a `_non-i` suffix over all
+ *   frames except I frames, e.g. `Av_Motion_kurtosis_non-i`
+ *
+ * Standard deviation, skewness and kurtosis are population statistics, and
+ * kurtosis is the excess kurtosis, as computed by numpy/scipy by default;
+ * skewness and kurtosis are 0 instead of NaN for constant values.
+ *
+ * The interquartile range is exact, with the linear interpolation between
+ * values of numpy's and scipy's defaults, because the reference computes it
+ * from all values, and a QuantileSketch is least accurate around the quartiles,
+ * where its clusters are largest. The values of every column are kept until the
+ * features are computed, 8 bytes per frame and column, and the non-I values
+ * are selected from them with a per-frame flag.
+ *
+ * The motion columns only match the input of the reference if FFmpeg was built
+ * in legacy mode (VP_MV_POC_NORMALIZATION=1), as the standard build
+ * normalizes the motion vectors differently.
+ */
+class P1204FeatureExtractor {
+public:
+  P1204FeatureExtractor();
+
+  /**
+   * @brief Add a frame
+   *
+   * @param frame_info The frame to add
+   */
+  void add_frame(const FrameInfo &frame_info);
+
+  /**
+   * @brief Compute the features
+   *
+   * @param sequence_info The final sequence info, as returned by
+   * VideoParser::get_sequence_info() after parsing
+   * @return P1204Features The features
+   */
+  P1204Features get_features(const SequenceInfo &sequence_info) const;
+
+private:
+  struct Column {
+    const char *name; // legacy column name
+    const FrameInfoField *field;
+    RunningStats all_stats;
+    RunningStats non_i_stats;
+    std::vector<double> values;
+  };
+
+  std::vector<Column> columns;
+  std::vector<bool> is_i_frame; // per frame, to select the non-I values
+};
+
+} // namespace videoparser
+
+#endif // VIDEOPARSER_P1204_FEATURES_H
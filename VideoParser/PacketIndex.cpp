@@ -0,0 +1,236 @@
+/**
+ * @file PacketIndex.cpp
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#include "PacketIndex.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+
+namespace videoparser {
+
+namespace {
+
+// File layout (all fixed-size values little-endian):
+//
+// header:  "VPINDEX2", uint64 file size, uint64 packet hash,
+//          int32 time_base.num, int32 time_base.den, uint32 stream index,
+//          uint64 entry count
+// entries: uint8 flags, then as zigzag LEB128 varints: pos delta, size,
+//          dts delta, pts - dts; timestamps that are missing are skipped
+const char magic[] = "VPINDEX2";
+const size_t magic_size = 8;
+
+enum EntryFlags : uint8_t {
+  FLAG_KEY = 1,
+  FLAG_NO_PTS = 2,
+  FLAG_NO_DTS = 4,
+};
+
+// 64-bit FNV-1a
+const uint64_t hash_offset_basis = 0xcbf29ce484222325ULL;
+const uint64_t hash_prime = 0x100000001b3ULL;
+
+void hash_bytes(uint64_t &hash, const char *data, size_t size) {
+  for (size_t i = 0; i < size; i++) {
+    hash = (hash ^ static_cast<uint8_t>(data[i])) * hash_prime;
+  }
+}
+
+void put_fixed(std::vector<uint8_t> &data, uint64_t value, int bytes) {
+  for (int i = 0; i < bytes; i++) {
+    data.push_back(static_cast<uint8_t>(value >> (8 * i)));
+  }
+}
+
+void put_varint(std::vector<uint8_t> &data, int64_t value) {
+  uint64_t zigzag = (static_cast<uint64_t>(value) << 1) ^
+                    static_cast<uint64_t>(value >> 63);
+  do {
+    uint8_t byte = zigzag & 0x7f;
+    zigzag >>= 7;
+    data.push_back(zigzag ? byte | 0x80 : byte);
+  } while (zigzag);
+}
+
+class Reader {
+public:
+  explicit Reader(const std::vector<uint8_t> &data) : data(data) {}
+
+  uint64_t get_fixed(int bytes) {
+    check(bytes);
+    uint64_t value = 0;
+    for (int i = 0; i < bytes; i++) {
+      value |= static_cast<uint64_t>(data[pos++]) << (8 * i);
+    }
+    return value;
+  }
+
+  int64_t get_varint() {
+    uint64_t zigzag = 0;
+    for (int shift = 0; shift < 64; shift += 7) {
+      check(1);
+      uint8_t byte = data[pos++];
+      zigzag |= static_cast<uint64_t>(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        return static_cast<int64_t>(zigzag >> 1) ^
+               -static_cast<int64_t>(zigzag & 1);
+      }
+    }
+    throw std::runtime_error("Error reading index: corrupt entry");
+  }
+
+private:
+  const std::vector<uint8_t> &data;
+  size_t pos = 0;
+
+  void check(size_t size) {
+    if (pos + size > data.size()) {
+      throw std::runtime_error("Error reading index: unexpected end of data");
+    }
+  }
+};
+
+} // namespace
+
+PacketIndex::PacketIndex(AVRational time_base, int stream_index,
+                         int64_t file_size)
+    : time_base(time_base), stream_index(stream_index), file_size(file_size) {}
+
+uint64_t PacketIndex::hash_packets(const std::string &filename) const {
+  uint64_t hash = hash_offset_basis;
+  auto has_pos = [](const PacketIndexEntry &e) { return e.pos >= 0; };
+  auto first = std::find_if(entries.begin(), entries.end(), has_pos);
+  auto last = std::find_if(entries.rbegin(), entries.rend(), has_pos);
+  if (first == entries.end()) {
+    return hash;
+  }
+  std::ifstream file(filename, std::ios::binary);
+  std::vector<char> data;
+  for (const PacketIndexEntry *entry : {&*first, &*last}) {
+    data.assign(static_cast<size_t>(std::max(entry->size, 0)), 0);
+    file.seekg(entry->pos);
+    file.read(data.data(), data.size());
+    // a file too short for the packet hashes differently
+    hash_bytes(hash, data.data(), static_cast<size_t>(file.gcount()));
+    file.clear();
+  }
+  return hash;
+}
+
+std::string PacketIndex::path_for(const std::string &filename) {
+  return filename + ".vpidx";
+}
+
+void PacketIndex::add(const AVPacket &packet) {
+  entries.push_back({packet.pos, packet.size, packet.pts, packet.dts,
+                     (packet.flags & AV_PKT_FLAG_KEY) != 0});
+}
+
+void PacketIndex::write(const std::string &path) const {
+  std::vector<uint8_t> data(magic, magic + magic_size);
+  put_fixed(data, static_cast<uint64_t>(file_size), 8);
+  put_fixed(data, packet_hash, 8);
+  put_fixed(data, static_cast<uint32_t>(time_base.num), 4);
+  put_fixed(data, static_cast<uint32_t>(time_base.den), 4);
+  put_fixed(data, static_cast<uint32_t>(stream_index), 4);
+  put_fixed(data, entries.size(), 8);
+
+  int64_t prev_pos = 0;
+  int64_t prev_dts = 0;
+  for (const PacketIndexEntry &entry : entries) {
+    uint8_t flags = entry.is_key ? FLAG_KEY : 0;
+    if (entry.pts == AV_NOPTS_VALUE) {
+      flags |= FLAG_NO_PTS;
+    }
+    if (entry.dts == AV_NOPTS_VALUE) {
+      flags |= FLAG_NO_DTS;
+    }
+    data.push_back(flags);
+    put_varint(data, entry.pos - prev_pos);
+    put_varint(data, entry.size);
+    prev_pos = entry.pos;
+    if (entry.dts != AV_NOPTS_VALUE) {
+      put_varint(data, entry.dts - prev_dts);
+      prev_dts = entry.dts;
+    }
+    if (entry.pts != AV_NOPTS_VALUE) {
+      put_varint(data, entry.pts - (entry.dts != AV_NOPTS_VALUE ? entry.dts
+                                                                : prev_dts));
+    }
+  }
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char *>(data.data()), data.size());
+  if (!file) {
+    throw std::runtime_error("Error writing index " + path);
+  }
+}
+
+std::optional<PacketIndex> PacketIndex::read(const std::string &path) {
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return std::nullopt;
+  }
+  std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)),
+                            std::istreambuf_iterator<char>());
+  if (data.size() < magic_size ||
+      !std::equal(magic, magic + magic_size, data.begin())) {
+    throw std::runtime_error("Error reading index " + path +
+                             ": not a packet index");
+  }
+
+  Reader reader(data);
+  reader.get_fixed(magic_size);
+  int64_t file_size = static_cast<int64_t>(reader.get_fixed(8));
+  uint64_t packet_hash = reader.get_fixed(8);
+  AVRational time_base;
+  time_base.num = static_cast<int>(reader.get_fixed(4));
+  time_base.den = static_cast<int>(reader.get_fixed(4));
+  int stream_index = static_cast<int>(reader.get_fixed(4));
+  uint64_t count = reader.get_fixed(8);
+
+  PacketIndex index(time_base, stream_index, file_size);
+  index.packet_hash = packet_hash;
+  // at least two bytes per entry, so a corrupt count cannot allocate much
+  index.entries.reserve(std::min<uint64_t>(count, data.size() / 2));
+  int64_t prev_pos = 0;
+  int64_t prev_dts = 0;
+  for (uint64_t i = 0; i < count; i++) {
+    PacketIndexEntry entry;
+    uint8_t flags = static_cast<uint8_t>(reader.get_fixed(1));
+    entry.is_key = flags & FLAG_KEY;
+    entry.pos = prev_pos + reader.get_varint();
+    entry.size = static_cast<int32_t>(reader.get_varint());
+    prev_pos = entry.pos;
+    entry.dts = AV_NOPTS_VALUE;
+    if (!(flags & FLAG_NO_DTS)) {
+      entry.dts = prev_dts + reader.get_varint();
+      prev_dts = entry.dts;
+    }
+    entry.pts = AV_NOPTS_VALUE;
+    if (!(flags & FLAG_NO_PTS)) {
+      entry.pts = prev_dts + reader.get_varint();
+    }
+    index.entries.push_back(entry);
+  }
+  return index;
+}
+
+int64_t PacketIndex::find_pos(int64_t pos) const {
+  // packets are stored in file order, so their offsets are ascending
+  auto entry = std::lower_bound(
+      entries.begin(), entries.end(), pos,
+      [](const PacketIndexEntry &e, int64_t value) { return e.pos < value; });
+  if (entry == entries.end() || entry->pos != pos) {
+    return -1;
+  }
+  return entry - entries.begin();
+}
+
+} // namespace videoparser
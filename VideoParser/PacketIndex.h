@@ -0,0 +1,123 @@
+/**
+ * @file PacketIndex.h
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#ifndef VIDEOPARSER_PACKET_INDEX_H
+#define VIDEOPARSER_PACKET_INDEX_H
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/packet.h>
+#include <libavutil/rational.h>
+}
+
+namespace videoparser {
+
+/**
+ * @brief A packet of the video stream, as listed in a PacketIndex.
+ */
+struct PacketIndexEntry {
+  int64_t pos;  /**< Byte offset of the packet in the file, -1 if unknown */
+  int32_t size; /**< Packet size in bytes */
+  int64_t pts;  /**< Presentation timestamp in the stream time base, or
+                   AV_NOPTS_VALUE */
+  int64_t dts;  /**< Decoding timestamp in the stream time base, or
+                   AV_NOPTS_VALUE */
+  bool is_key;  /**< Whether the packet has the key frame flag */
+};
+
+/**
+ * @brief A sidecar index of all packets of the video stream (`.vpidx`).
+ *
+ * It is written after a parse that read the whole file, and lets later
+ * parses of the same file seek and count frames without scanning it, which
+ * matters for containers without an index of their own, such as MPEG-TS and
+ * raw Annex B streams. Entries are in decoding order, and are stored as
+ * variable-length deltas, typically 5-8 bytes per packet.
+ */
+class PacketIndex {
+public:
+  /**
+   * @brief Construct an empty index
+   *
+   * @param time_base Time base of the timestamps
+   * @param stream_index Index of the video stream in the file
+   * @param file_size Size of the indexed file in bytes, to detect an outdated
+   * index
+   */
+  PacketIndex(AVRational time_base, int stream_index, int64_t file_size);
+
+  /**
+   * @brief Hash the bytes of the first and the last packet in a file
+   *
+   * Stored with the index, this detects an index of another version of the
+   * file that happens to have the same size, e.g. after re-encoding it with
+   * the same bitrate or editing it in place.
+   *
+   * @param filename The indexed file
+   * @return uint64_t The hash of the bytes at the offsets of the entries
+   */
+  uint64_t hash_packets(const std::string &filename) const;
+
+  /**
+   * @brief The sidecar path of a file: the file name with `.vpidx` appended
+   */
+  static std::string path_for(const std::string &filename);
+
+  /**
+   * @brief Add a packet, in decoding order
+   */
+  void add(const AVPacket &packet);
+
+  /**
+   * @brief Write the index
+   *
+   * @param path The sidecar path
+   * @throws std::runtime_error If the file cannot be written
+   */
+  void write(const std::string &path) const;
+
+  /**
+   * @brief Read an index, if it exists
+   *
+   * @param path The sidecar path
+   * @return std::optional<PacketIndex> The index, or nothing if the file does
+   * not exist
+   * @throws std::runtime_error If the file is not a valid index
+   */
+  static std::optional<PacketIndex> read(const std::string &path);
+
+  /**
+   * @brief Find the entry of a packet by its byte offset
+   *
+   * @param pos The byte offset
+   * @return int64_t The position of the entry, i.e. the packet's index in
+   * decoding order, or -1 if there is none
+   */
+  int64_t find_pos(int64_t pos) const;
+
+  const std::vector<PacketIndexEntry> &get_entries() const { return entries; }
+  AVRational get_time_base() const { return time_base; }
+  int get_stream_index() const { return stream_index; }
+  int64_t get_file_size() const { return file_size; }
+  uint64_t get_packet_hash() const { return packet_hash; }
+  void set_packet_hash(uint64_t hash) { packet_hash = hash; }
+
+private:
+  AVRational time_base;
+  int stream_index;
+  int64_t file_size;
+  uint64_t packet_hash = 0;
+  std::vector<PacketIndexEntry> entries;
+};
+
+} // namespace videoparser
+
+#endif // VIDEOPARSER_PACKET_INDEX_H
@@ -0,0 +1,265 @@
+/**
+ * @file Statistics.cpp
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#include "Statistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace videoparser {
+
+void RunningStats::add(double value) {
+  double n1 = static_cast<double>(n);
+  n++;
+  double delta = value - m1;
+  double delta_n = delta / n;
+  double delta_n2 = delta_n * delta_n;
+  double term = delta * delta_n * n1;
+  m1 += delta_n;
+  m4 += term * delta_n2 * (1.0 * n * n - 3.0 * n + 3) + 6 * delta_n2 * m2 -
+        4 * delta_n * m3;
+  m3 += term * delta_n * (n - 2.0) - 3 * delta_n * m2;
+  m2 += term;
+  min_value = std::min(min_value, value);
+  max_value = std::max(max_value, value);
+}
+
+void RunningStats::merge(const RunningStats &other) {
+  if (other.n == 0) {
+    return;
+  }
+  if (n == 0) {
+    *this = other;
+    return;
+  }
+
+  // Chan et al. and Pébay, parallel variant of Welford's algorithm
+  double na = static_cast<double>(n);
+  double nb = static_cast<double>(other.n);
+  double total = na + nb;
+  double delta = other.m1 - m1;
+  double delta2 = delta * delta;
+
+  m4 += other.m4 +
+        delta2 * delta2 * na * nb * (na * na - na * nb + nb * nb) /
+            (total * total * total) +
+        6 * delta2 * (na * na * other.m2 + nb * nb * m2) / (total * total) +
+        4 * delta * (na * other.m3 - nb * m3) / total;
+  m3 += other.m3 + delta2 * delta * na * nb * (na - nb) / (total * total) +
+        3 * delta * (na * other.m2 - nb * m2) / total;
+  m2 += other.m2 + delta2 * na * nb / total;
+  m1 += delta * nb / total;
+  n += other.n;
+  min_value = std::min(min_value, other.min_value);
+  max_value = std::max(max_value, other.max_value);
+}
+
+double RunningStats::stdev() const { return std::sqrt(variance()); }
+
+double RunningStats::skewness() const {
+  if (n == 0 || m2 <= 0) {
+    return 0.0;
+  }
+  return std::sqrt(static_cast<double>(n)) * m3 / std::pow(m2, 1.5);
+}
+
+double RunningStats::kurtosis() const {
+  if (n == 0 || m2 <= 0) {
+    return 0.0;
+  }
+  return n * m4 / (m2 * m2) - 3.0;
+}
+
+namespace {
+
+// k1 scale function of the t-digest and its inverse
+double q_to_k(double q, double compression) {
+  return compression / (2 * M_PI) * std::asin(2 * q - 1);
+}
+
+double k_to_q(double k, double compression) {
+  if (k >= compression / 4) {
+    return 1.0;
+  }
+  return (std::sin(k * 2 * M_PI / compression) + 1) / 2;
+}
+
+} // namespace
+
+QuantileSketch::QuantileSketch(double compression) : compression(compression) {
+  if (compression < 10) {
+    throw std::runtime_error("Invalid t-digest compression");
+  }
+  buffer.reserve(static_cast<size_t>(5 * compression));
+}
+
+void QuantileSketch::add(double value, double weight) {
+  if (std::isnan(value) || weight <= 0) {
+    return;
+  }
+  buffer.push_back({value, weight});
+  buffer_weight += weight;
+  min_value = std::min(min_value, value);
+  max_value = std::max(max_value, value);
+  if (buffer.size() >= static_cast<size_t>(5 * compression)) {
+    compress();
+  }
+}
+
+void QuantileSketch::merge(const QuantileSketch &other) {
+  for (const auto &centroid : other.get_centroids()) {
+    add(centroid.mean, centroid.weight);
+  }
+  // the other sketch's extremes may lie outside its centroid means
+  min_value = std::min(min_value, other.min_value);
+  max_value = std::max(max_value, other.max_value);
+}
+
+void QuantileSketch::compress() const {
+  if (buffer.empty()) {
+    return;
+  }
+
+  buffer.insert(buffer.end(), centroids.begin(), centroids.end());
+  std::sort(buffer.begin(), buffer.end(),
+            [](const Centroid &a, const Centroid &b) {
+              return a.mean < b.mean;
+            });
+
+  double total = merged_weight + buffer_weight;
+  centroids.clear();
+
+  Centroid current = buffer[0];
+  double weight_so_far = 0;
+  double q_limit = k_to_q(q_to_k(0, compression) + 1, compression);
+  for (size_t i = 1; i < buffer.size(); i++) {
+    const Centroid &next = buffer[i];
+    double q_right = (weight_so_far + current.weight + next.weight) / total;
+    if (q_right <= q_limit) {
+      current.weight += next.weight;
+      current.mean += (next.mean - current.mean) * next.weight / current.weight;
+    } else {
+      weight_so_far += current.weight;
+      centroids.push_back(current);
+      q_limit = k_to_q(q_to_k(weight_so_far / total, compression) + 1,
+                       compression);
+      current = next;
+    }
+  }
+  centroids.push_back(current);
+
+  buffer.clear();
+  merged_weight = total;
+  buffer_weight = 0;
+}
+
+const std::vector<QuantileSketch::Centroid> &
+QuantileSketch::get_centroids() const {
+  compress();
+  return centroids;
+}
+
+double QuantileSketch::quantile(double q) const {
+  compress();
+  if (centroids.empty()) {
+    return 0.0;
+  }
+  if (centroids.size() == 1) {
+    return centroids[0].mean;
+  }
+
+  q = std::min(std::max(q, 0.0), 1.0);
+  double total = merged_weight;
+  double index = q * total;
+
+  // between the minimum and the center of the first centroid
+  const Centroid &first = centroids.front();
+  if (index < first.weight / 2) {
+    return min_value + (first.mean - min_value) * index / (first.weight / 2);
+  }
+
+  // between the centers of two neighboring centroids
+  double weight_so_far = first.weight / 2;
+  for (size_t i = 0; i + 1 < centroids.size(); i++) {
+    double delta = (centroids[i].weight + centroids[i + 1].weight) / 2;
+    if (weight_so_far + delta > index) {
+      double left = index - weight_so_far;
+      return centroids[i].mean +
+             (centroids[i + 1].mean - centroids[i].mean) * left / delta;
+    }
+    weight_so_far += delta;
+  }
+
+  // between the center of the last centroid and the maximum
+  const Centroid &last = centroids.back();
+  double right = index - weight_so_far;
+  return last.mean + (max_value - last.mean) * right / (last.weight / 2);
+}
+
+SequenceAggregator::SequenceAggregator() {
+  size_t field_count = frame_info_fields().size();
+  all_frames.fields.resize(field_count);
+  for (auto &aggregates : by_frame_type) {
+    aggregates.fields.resize(field_count);
+  }
+}
+
+bool SequenceAggregator::is_aggregated(const FrameInfoField &field) {
+  static const char *identifiers[] = {"frame_idx", "pts", "dts", "frame_type",
+                                      "is_idr"};
+  for (const char *name : identifiers) {
+    if (strcmp(field.name, name) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void SequenceAggregator::add_frame(const FrameInfo &frame_info) {
+  if (frame_info.frame_type < UNKNOWN || frame_info.frame_type > B) {
+    throw std::runtime_error("Invalid frame type");
+  }
+  FrameAggregates &typed = by_frame_type[frame_info.frame_type];
+
+  const auto &fields = frame_info_fields();
+  for (size_t i = 0; i < fields.size(); i++) {
+    if (!is_aggregated(fields[i])) {
+      continue;
+    }
+    double value = fields[i].get(frame_info);
+    all_frames.fields[i].add(value);
+    typed.fields[i].add(value);
+  }
+  all_frames.frame_count++;
+  typed.frame_count++;
+}
+
+void SequenceAggregator::merge(const SequenceAggregator &other) {
+  auto merge_aggregates = [](FrameAggregates &to, const FrameAggregates &from) {
+    to.frame_count += from.frame_count;
+    for (size_t i = 0; i < to.fields.size(); i++) {
+      to.fields[i].merge(from.fields[i]);
+    }
+  };
+
+  merge_aggregates(all_frames, other.all_frames);
+  for (int i = UNKNOWN; i <= B; i++) {
+    merge_aggregates(by_frame_type[i], other.by_frame_type[i]);
+  }
+}
+
+const FrameAggregates &
+SequenceAggregator::for_frame_type(FrameType frame_type) const {
+  if (frame_type < UNKNOWN || frame_type > B) {
+    throw std::runtime_error("Invalid frame type");
+  }
+  return by_frame_type[frame_type];
+}
+
+} // namespace videoparser
@@ -0,0 +1,239 @@
+/**
+ * @file Statistics.h
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#ifndef VIDEOPARSER_STATISTICS_H
+#define VIDEOPARSER_STATISTICS_H
+
+#include "VideoParser.h"
+
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace videoparser {
+
+/**
+ * @brief Streaming mean, standard deviation, skewness, kurtosis, minimum and
+ * maximum.
+ *
+ * Uses Welford's online algorithm, extended to the third and fourth central
+ * moments (Terriberry), which is numerically stable for long streams, and
+ * needs constant memory. Two accumulators can be merged (Pébay), e.g. to
+ * combine the statistics of several files or workers.
+ */
+class RunningStats {
+public:
+  /**
+   * @brief Add a value
+   *
+   * @param value The value to add
+   */
+  void add(double value);
+
+  /**
+   * @brief Merge another accumulator into this one
+   *
+   * The result is the same as if all values had been added to this
+   * accumulator.
+   *
+   * @param other The accumulator to merge
+   */
+  void merge(const RunningStats &other);
+
+  uint64_t count() const { return n; } /**< Number of values */
+  double mean() const { return n ? m1 : 0.0; } /**< Mean of the values */
+  double min() const { return n ? min_value : 0.0; } /**< Smallest value */
+  double max() const { return n ? max_value : 0.0; } /**< Largest value */
+
+  /**
+   * @brief Population variance of the values
+   *
+   * Uses the same definition as the per-frame `*_stdev` metrics.
+   *
+   * @return double The variance, or 0 if there are no values
+   */
+  double variance() const { return n ? m2 / n : 0.0; }
+
+  /**
+   * @brief Population standard deviation of the values
+   *
+   * @return double The standard deviation, or 0 if there are no values
+   */
+  double stdev() const;
+
+  /**
+   * @brief Population skewness of the values
+   *
+   * @return double The skewness, or 0 if the variance is 0
+   */
+  double skewness() const;
+
+  /**
+   * @brief Population excess kurtosis of the values
+   *
+   * @return double The kurtosis (0 for a normal distribution), or 0 if the
+   * variance is 0
+   */
+  double kurtosis() const;
+
+private:
+  uint64_t n = 0;
+  double m1 = 0.0; // running mean
+  double m2 = 0.0; // sum of squared differences from the mean
+  double m3 = 0.0; // sum of cubed differences from the mean
+  double m4 = 0.0; // sum of differences from the mean to the fourth power
+  double min_value = std::numeric_limits<double>::infinity();
+  double max_value = -std::numeric_limits<double>::infinity();
+};
+
+/**
+ * @brief Streaming quantile estimation with a t-digest.
+ *
+ * Implements the merging t-digest by Dunning and Ertl: values are buffered and
+ * periodically merged into a sorted list of centroids, whose sizes are bounded
+ * by the k1 scale function. Memory is bounded by the compression parameter,
+ * regardless of the number of values, and the error is smallest for extreme
+ * quantiles (e.g. p1 or p99). Sketches can be merged, e.g. to combine the
+ * statistics of several files or workers, by merging their centroids.
+ */
+class QuantileSketch {
+public:
+  /**
+   * @brief A cluster of values, represented by its mean and weight.
+   */
+  struct Centroid {
+    double mean;   /**< Mean of the values in the cluster */
+    double weight; /**< Number of values in the cluster */
+  };
+
+  /**
+   * @brief Construct a new sketch
+   *
+   * @param compression Accuracy parameter; the number of centroids is in the
+   * order of this value
+   */
+  QuantileSketch(double compression = 100);
+
+  /**
+   * @brief Add a value
+   *
+   * @param value The value to add
+   * @param weight The weight of the value
+   */
+  void add(double value, double weight = 1);
+
+  /**
+   * @brief Merge another sketch into this one
+   *
+   * @param other The sketch to merge
+   */
+  void merge(const QuantileSketch &other);
+
+  /**
+   * @brief Estimate a quantile
+   *
+   * @param q The quantile, between 0 and 1 (e.g. 0.95 for p95)
+   * @return double The estimated value, or 0 if no values were added
+   */
+  double quantile(double q) const;
+
+  /**
+   * @brief Get the total weight of all values added
+   *
+   * @return double The total weight
+   */
+  double count() const { return merged_weight + buffer_weight; }
+
+  /**
+   * @brief Get the centroids of the sketch, sorted by mean
+   *
+   * Together with add(), this can be used to serialize a sketch: adding all
+   * centroids (with their weights) to an empty sketch restores it.
+   *
+   * @return const std::vector<Centroid>& The centroids
+   */
+  const std::vector<Centroid> &get_centroids() const;
+
+private:
+  double compression;
+  double min_value = std::numeric_limits<double>::infinity();
+  double max_value = -std::numeric_limits<double>::infinity();
+
+  // merging happens lazily, also from const methods
+  mutable std::vector<Centroid> centroids;
+  mutable std::vector<Centroid> buffer;
+  mutable double merged_weight = 0;
+  mutable double buffer_weight = 0;
+
+  void compress() const;
+};
+
+/**
+ * @brief Running statistics for every aggregated FrameInfo field.
+ */
+struct FrameAggregates {
+  uint64_t frame_count = 0; /**< Number of frames added */
+  /** Statistics per field, indexed like frame_info_fields() */
+  std::vector<RunningStats> fields;
+};
+
+/**
+ * @brief Aggregates FrameInfo records into per-sequence statistics.
+ *
+ * Statistics are kept for all frames and separately for each frame type.
+ * Identifiers and timestamps (`frame_idx`, `pts`, `dts`, `frame_type`,
+ * `is_idr`) are not aggregated, see is_aggregated().
+ */
+class SequenceAggregator {
+public:
+  SequenceAggregator();
+
+  /**
+   * @brief Add a frame
+   *
+   * @param frame_info The frame to add
+   */
+  void add_frame(const FrameInfo &frame_info);
+
+  /**
+   * @brief Merge another aggregator into this one
+   *
+   * @param other The aggregator to merge
+   */
+  void merge(const SequenceAggregator &other);
+
+  /**
+   * @brief Get the statistics over all frames
+   *
+   * @return const FrameAggregates& The statistics
+   */
+  const FrameAggregates &overall() const { return all_frames; }
+
+  /**
+   * @brief Get the statistics over all frames of one type
+   *
+   * @param frame_type The frame type
+   * @return const FrameAggregates& The statistics
+   */
+  const FrameAggregates &for_frame_type(FrameType frame_type) const;
+
+  /**
+   * @brief Check whether a field is aggregated
+   *
+   * @param field The field, from frame_info_fields()
+   * @return true If the field is a metric that is aggregated
+   */
+  static bool is_aggregated(const FrameInfoField &field);
+
+private:
+  FrameAggregates all_frames;
+  FrameAggregates by_frame_type[4]; // indexed by FrameType
+};
+
+} // namespace videoparser
+
+#endif // VIDEOPARSER_STATISTICS_H
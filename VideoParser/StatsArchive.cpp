@@ -0,0 +1,684 @@
+/**
+ * @file StatsArchive.cpp
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#include "StatsArchive.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+namespace videoparser {
+
+namespace {
+
+// File layout (all values little-endian):
+//
+// header:  "VPARCHV1", int32 time_base.num, int32 time_base.den,
+//          uint32 column count, per column: uint8 name length, name,
+//          uint8 encoding
+// blocks:  uint32 frame count, per column: uint32 byte length, bit stream;
+//          timestamp columns start with a 1-bit flag for missing values,
+//          followed by a presence bit per frame if it is set
+// footer:  sequence info, uint32 block count, per block: uint64 offset,
+//          uint32 frame count, double pts_min, double pts_max
+// trailer: uint64 footer offset, "VPARIDX1"
+const char header_magic[] = "VPARCHV1";
+const char trailer_magic[] = "VPARIDX1";
+const size_t magic_size = 8;
+const size_t trailer_size = 8 + magic_size;
+
+enum ColumnEncoding : uint8_t {
+  ENCODING_TIMESTAMP = 0, // presence bits, time base ticks, delta-of-delta
+  ENCODING_DELTA_OF_DELTA = 1,
+  ENCODING_DELTA = 2,
+  ENCODING_XOR = 3,
+};
+
+ColumnEncoding encoding_for(const FrameInfoField &field) {
+  std::string name = field.name;
+  if (name == "pts" || name == "dts") {
+    return ENCODING_TIMESTAMP;
+  }
+  if (name == "frame_idx" || name == "current_poc") {
+    return ENCODING_DELTA_OF_DELTA;
+  }
+  return field.is_integer ? ENCODING_DELTA : ENCODING_XOR;
+}
+
+/**
+ * @brief Little-endian serialization of fixed-size values.
+ */
+class ByteWriter {
+public:
+  std::vector<uint8_t> data;
+
+  void put_u8(uint8_t value) { data.push_back(value); }
+
+  void put_u32(uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+      data.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+  }
+
+  void put_u64(uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+      data.push_back(static_cast<uint8_t>(value >> (8 * i)));
+    }
+  }
+
+  void put_double(double value) {
+    uint64_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    put_u64(bits);
+  }
+
+  void put_bytes(const void *bytes, size_t size) {
+    const uint8_t *p = static_cast<const uint8_t *>(bytes);
+    data.insert(data.end(), p, p + size);
+  }
+};
+
+class ByteReader {
+public:
+  ByteReader(const std::vector<uint8_t> &data) : data(data) {}
+
+  uint8_t get_u8() {
+    check(1);
+    return data[pos++];
+  }
+
+  uint32_t get_u32() {
+    check(4);
+    uint32_t value = 0;
+    for (int i = 0; i < 4; i++) {
+      value |= static_cast<uint32_t>(data[pos++]) << (8 * i);
+    }
+    return value;
+  }
+
+  uint64_t get_u64() {
+    check(8);
+    uint64_t value = 0;
+    for (int i = 0; i < 8; i++) {
+      value |= static_cast<uint64_t>(data[pos++]) << (8 * i);
+    }
+    return value;
+  }
+
+  double get_double() {
+    uint64_t bits = get_u64();
+    double value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+  }
+
+  void get_bytes(void *bytes, size_t size) {
+    check(size);
+    memcpy(bytes, data.data() + pos, size);
+    pos += size;
+  }
+
+private:
+  const std::vector<uint8_t> &data;
+  size_t pos = 0;
+
+  void check(size_t size) {
+    if (pos + size > data.size()) {
+      throw std::runtime_error("Error reading archive: unexpected end of data");
+    }
+  }
+};
+
+/**
+ * @brief MSB-first bit stream writer.
+ */
+class BitWriter {
+public:
+  std::vector<uint8_t> data;
+
+  void put_bits(uint64_t value, int count) {
+    for (int i = count - 1; i >= 0; i--) {
+      if (bit_pos == 0) {
+        data.push_back(0);
+      }
+      if ((value >> i) & 1) {
+        data.back() |= 0x80 >> bit_pos;
+      }
+      bit_pos = (bit_pos + 1) & 7;
+    }
+  }
+
+private:
+  int bit_pos = 0;
+};
+
+class BitReader {
+public:
+  BitReader(const uint8_t *data, size_t size) : data(data), size(size) {}
+
+  uint64_t get_bits(int count) {
+    uint64_t value = 0;
+    for (int i = 0; i < count; i++) {
+      if (pos >= size * 8) {
+        throw std::runtime_error("Error reading archive: corrupt block");
+      }
+      value = (value << 1) | ((data[pos >> 3] >> (7 - (pos & 7))) & 1);
+      pos++;
+    }
+    return value;
+  }
+
+private:
+  const uint8_t *data;
+  size_t size;
+  size_t pos = 0;
+};
+
+uint64_t zigzag_encode(int64_t value) {
+  return (static_cast<uint64_t>(value) << 1) ^
+         static_cast<uint64_t>(value >> 63);
+}
+
+int64_t zigzag_decode(uint64_t value) {
+  return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+}
+
+// Variable-length integer buckets: a unary prefix selects the payload width
+const int bucket_bits[] = {7, 9, 16, 32, 64};
+const int bucket_count = sizeof(bucket_bits) / sizeof(bucket_bits[0]);
+
+void put_varint(BitWriter &writer, int64_t value) {
+  uint64_t zigzag = zigzag_encode(value);
+  if (zigzag == 0) {
+    writer.put_bits(0, 1);
+    return;
+  }
+  for (int i = 0; i < bucket_count; i++) {
+    int bits = bucket_bits[i];
+    if (bits == 64 || zigzag < (uint64_t(1) << bits)) {
+      // prefix: i + 1 ones, terminated by a zero unless it is the last bucket
+      writer.put_bits(~uint64_t(0), i + 1);
+      if (i < bucket_count - 1) {
+        writer.put_bits(0, 1);
+      }
+      writer.put_bits(zigzag, bits);
+      return;
+    }
+  }
+}
+
+int64_t get_varint(BitReader &reader) {
+  int ones = 0;
+  while (ones < bucket_count && reader.get_bits(1) == 1) {
+    ones++;
+  }
+  if (ones == 0) {
+    return 0;
+  }
+  return zigzag_decode(reader.get_bits(bucket_bits[ones - 1]));
+}
+
+int count_leading_zeros(uint64_t value) {
+  int count = 0;
+  for (uint64_t mask = uint64_t(1) << 63; mask && !(value & mask); mask >>= 1) {
+    count++;
+  }
+  return count;
+}
+
+int count_trailing_zeros(uint64_t value) {
+  int count = 0;
+  for (uint64_t mask = 1; mask && !(value & mask); mask <<= 1) {
+    count++;
+  }
+  return count;
+}
+
+uint64_t double_bits(double value) {
+  uint64_t bits;
+  memcpy(&bits, &value, sizeof(bits));
+  return bits;
+}
+
+double bits_double(uint64_t bits) {
+  double value;
+  memcpy(&value, &bits, sizeof(value));
+  return value;
+}
+
+void encode_integers(BitWriter &writer, const std::vector<int64_t> &values,
+                     bool delta_of_delta) {
+  int64_t prev = 0;
+  int64_t prev_delta = 0;
+  for (size_t i = 0; i < values.size(); i++) {
+    if (i == 0) {
+      writer.put_bits(static_cast<uint64_t>(values[0]), 64);
+    } else {
+      int64_t delta = values[i] - prev;
+      put_varint(writer, delta_of_delta ? delta - prev_delta : delta);
+      prev_delta = delta;
+    }
+    prev = values[i];
+  }
+}
+
+std::vector<int64_t> decode_integers(BitReader &reader, uint32_t count,
+                                     bool delta_of_delta) {
+  std::vector<int64_t> values(count);
+  int64_t prev_delta = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (i == 0) {
+      values[0] = static_cast<int64_t>(reader.get_bits(64));
+      continue;
+    }
+    int64_t delta = get_varint(reader);
+    if (delta_of_delta) {
+      delta += prev_delta;
+    }
+    values[i] = values[i - 1] + delta;
+    prev_delta = delta;
+  }
+  return values;
+}
+
+std::vector<uint8_t> encode_doubles(const std::vector<double> &values) {
+  BitWriter writer;
+  uint64_t prev = 0;
+  int prev_leading = -1;
+  int prev_trailing = 0;
+  for (size_t i = 0; i < values.size(); i++) {
+    uint64_t bits = double_bits(values[i]);
+    if (i == 0) {
+      writer.put_bits(bits, 64);
+      prev = bits;
+      continue;
+    }
+
+    uint64_t x = bits ^ prev;
+    prev = bits;
+    if (x == 0) {
+      writer.put_bits(0, 1);
+      continue;
+    }
+    writer.put_bits(1, 1);
+
+    int leading = count_leading_zeros(x);
+    int trailing = count_trailing_zeros(x);
+    if (prev_leading >= 0 && leading >= prev_leading &&
+        trailing >= prev_trailing) {
+      // meaningful bits fit into the previous window
+      writer.put_bits(0, 1);
+      writer.put_bits(x >> prev_trailing, 64 - prev_leading - prev_trailing);
+    } else {
+      int length = 64 - leading - trailing;
+      writer.put_bits(1, 1);
+      writer.put_bits(leading, 6);
+      writer.put_bits(length - 1, 6);
+      writer.put_bits(x >> trailing, length);
+      prev_leading = leading;
+      prev_trailing = trailing;
+    }
+  }
+  return writer.data;
+}
+
+std::vector<double> decode_doubles(BitReader &reader, uint32_t count) {
+  std::vector<double> values(count);
+  uint64_t prev = 0;
+  int prev_leading = 0;
+  int prev_trailing = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    if (i == 0) {
+      prev = reader.get_bits(64);
+    } else if (reader.get_bits(1) == 1) {
+      if (reader.get_bits(1) == 1) {
+        prev_leading = static_cast<int>(reader.get_bits(6));
+        int length = static_cast<int>(reader.get_bits(6)) + 1;
+        prev_trailing = 64 - prev_leading - length;
+        if (prev_trailing < 0) {
+          throw std::runtime_error("Error reading archive: corrupt block");
+        }
+      }
+      int length = 64 - prev_leading - prev_trailing;
+      prev ^= reader.get_bits(length) << prev_trailing;
+    }
+    values[i] = bits_double(prev);
+  }
+  return values;
+}
+
+void write_sequence_info(ByteWriter &writer, const SequenceInfo &info) {
+  writer.put_double(info.video_duration);
+  writer.put_bytes(info.video_codec, sizeof(info.video_codec));
+  writer.put_double(info.video_bitrate);
+  writer.put_double(info.video_framerate);
+  writer.put_u32(static_cast<uint32_t>(info.video_width));
+  writer.put_u32(static_cast<uint32_t>(info.video_height));
+  writer.put_u32(static_cast<uint32_t>(info.video_codec_profile));
+  writer.put_u32(static_cast<uint32_t>(info.video_codec_level));
+  writer.put_u32(static_cast<uint32_t>(info.video_bit_depth));
+  writer.put_bytes(info.video_pix_fmt, sizeof(info.video_pix_fmt));
+  writer.put_u32(info.video_frame_count);
+}
+
+void read_sequence_info(ByteReader &reader, SequenceInfo &info) {
+  info.video_duration = reader.get_double();
+  reader.get_bytes(info.video_codec, sizeof(info.video_codec));
+  info.video_codec[sizeof(info.video_codec) - 1] = '\0';
+  info.video_bitrate = reader.get_double();
+  info.video_framerate = reader.get_double();
+  info.video_width = static_cast<int>(reader.get_u32());
+  info.video_height = static_cast<int>(reader.get_u32());
+  info.video_codec_profile = static_cast<int>(reader.get_u32());
+  info.video_codec_level = static_cast<int>(reader.get_u32());
+  info.video_bit_depth = static_cast<int>(reader.get_u32());
+  reader.get_bytes(info.video_pix_fmt, sizeof(info.video_pix_fmt));
+  info.video_pix_fmt[sizeof(info.video_pix_fmt) - 1] = '\0';
+  info.video_frame_count = reader.get_u32();
+}
+
+} // namespace
+
+ArchiveWriter::ArchiveWriter(OutputWriter &output, AVRational time_base,
+                             uint32_t block_size)
+    : output(output), time_base(time_base), block_size(block_size) {
+  if (time_base.num <= 0 || time_base.den <= 0) {
+    throw std::runtime_error("Error creating archive: invalid time base");
+  }
+  if (block_size == 0) {
+    throw std::runtime_error("Error creating archive: invalid block size");
+  }
+
+  ByteWriter header;
+  header.put_bytes(header_magic, magic_size);
+  header.put_u32(static_cast<uint32_t>(time_base.num));
+  header.put_u32(static_cast<uint32_t>(time_base.den));
+
+  const auto &fields = frame_info_fields();
+  header.put_u32(static_cast<uint32_t>(fields.size()));
+  for (const auto &field : fields) {
+    size_t length = strlen(field.name);
+    header.put_u8(static_cast<uint8_t>(length));
+    header.put_bytes(field.name, length);
+    header.put_u8(encoding_for(field));
+  }
+  write_bytes(header.data);
+
+  pending.reserve(block_size);
+}
+
+void ArchiveWriter::write_bytes(const std::vector<uint8_t> &data) {
+  output.write(reinterpret_cast<const char *>(data.data()), data.size());
+  offset += data.size();
+}
+
+void ArchiveWriter::add_frame(const FrameInfo &frame_info) {
+  pending.push_back(frame_info);
+  if (pending.size() == block_size) {
+    flush_block();
+  }
+}
+
+void ArchiveWriter::flush_block() {
+  if (pending.empty()) {
+    return;
+  }
+
+  ArchiveBlock block;
+  block.offset = offset;
+  block.frame_count = static_cast<uint32_t>(pending.size());
+  // NaN if no frame of the block has a PTS
+  block.pts_min = NAN;
+  block.pts_max = NAN;
+  for (const auto &frame_info : pending) {
+    if (std::isnan(frame_info.pts)) {
+      continue;
+    }
+    if (!(block.pts_min <= frame_info.pts)) {
+      block.pts_min = frame_info.pts;
+    }
+    if (!(block.pts_max >= frame_info.pts)) {
+      block.pts_max = frame_info.pts;
+    }
+  }
+
+  ByteWriter writer;
+  writer.put_u32(block.frame_count);
+
+  double ticks_per_second = 1.0 / av_q2d(time_base);
+  for (const auto &field : frame_info_fields()) {
+    ColumnEncoding encoding = encoding_for(field);
+    std::vector<uint8_t> column;
+    if (encoding == ENCODING_XOR) {
+      std::vector<double> values;
+      values.reserve(pending.size());
+      for (const auto &frame_info : pending) {
+        values.push_back(field.get(frame_info));
+      }
+      column = encode_doubles(values);
+    } else if (encoding == ENCODING_TIMESTAMP) {
+      // missing timestamps (NaN, e.g. in packets of raw streams) are marked
+      // in the presence bits and repeat the previous value, which keeps the
+      // deltas small
+      bool has_missing = false;
+      for (const auto &frame_info : pending) {
+        has_missing = has_missing || std::isnan(field.get(frame_info));
+      }
+      BitWriter bits;
+      bits.put_bits(has_missing ? 1 : 0, 1);
+      std::vector<int64_t> values;
+      values.reserve(pending.size());
+      int64_t previous = 0;
+      for (const auto &frame_info : pending) {
+        double value = field.get(frame_info);
+        if (has_missing) {
+          bits.put_bits(std::isnan(value) ? 0 : 1, 1);
+        }
+        if (!std::isnan(value)) {
+          previous = std::llround(value * ticks_per_second);
+        }
+        values.push_back(previous);
+      }
+      encode_integers(bits, values, true);
+      column = std::move(bits.data);
+    } else {
+      std::vector<int64_t> values;
+      values.reserve(pending.size());
+      for (const auto &frame_info : pending) {
+        values.push_back(std::llround(field.get(frame_info)));
+      }
+      BitWriter bits;
+      encode_integers(bits, values, encoding != ENCODING_DELTA);
+      column = std::move(bits.data);
+    }
+    writer.put_u32(static_cast<uint32_t>(column.size()));
+    writer.put_bytes(column.data(), column.size());
+  }
+
+  write_bytes(writer.data);
+  index.push_back(block);
+  pending.clear();
+}
+
+void ArchiveWriter::close(const SequenceInfo &sequence_info) {
+  flush_block();
+
+  uint64_t footer_offset = offset;
+  ByteWriter footer;
+  write_sequence_info(footer, sequence_info);
+  footer.put_u32(static_cast<uint32_t>(index.size()));
+  for (const auto &block : index) {
+    footer.put_u64(block.offset);
+    footer.put_u32(block.frame_count);
+    footer.put_double(block.pts_min);
+    footer.put_double(block.pts_max);
+  }
+  footer.put_u64(footer_offset);
+  footer.put_bytes(trailer_magic, magic_size);
+  write_bytes(footer.data);
+}
+
+ArchiveReader::ArchiveReader(const std::string &path)
+    : file(path, std::ios::binary) {
+  if (!file) {
+    throw std::runtime_error("Error opening archive " + path);
+  }
+
+  auto read_at = [this](uint64_t position, size_t size) {
+    std::vector<uint8_t> data(size);
+    file.seekg(static_cast<std::streamoff>(position));
+    if (!file.read(reinterpret_cast<char *>(data.data()), size)) {
+      throw std::runtime_error("Error reading archive: unexpected end of file");
+    }
+    return data;
+  };
+
+  file.seekg(0, std::ios::end);
+  file_size = file.tellg();
+  uint64_t size = static_cast<uint64_t>(file_size);
+  if (size < magic_size + trailer_size) {
+    throw std::runtime_error("Error reading archive: file too small");
+  }
+
+  // trailer
+  std::vector<uint8_t> trailer = read_at(size - trailer_size, trailer_size);
+  ByteReader trailer_reader(trailer);
+  uint64_t footer_offset = trailer_reader.get_u64();
+  char magic[magic_size];
+  trailer_reader.get_bytes(magic, magic_size);
+  if (memcmp(magic, trailer_magic, magic_size) != 0 ||
+      footer_offset > size - trailer_size) {
+    throw std::runtime_error(
+        "Error reading archive: missing index, was the archive closed?");
+  }
+
+  // header: read generously, column names are short
+  std::vector<uint8_t> header =
+      read_at(0, static_cast<size_t>(std::min<uint64_t>(footer_offset, 65536)));
+  ByteReader header_reader(header);
+  header_reader.get_bytes(magic, magic_size);
+  if (memcmp(magic, header_magic, magic_size) != 0) {
+    throw std::runtime_error("Error reading archive: not a videoparser archive");
+  }
+  time_base.num = static_cast<int>(header_reader.get_u32());
+  time_base.den = static_cast<int>(header_reader.get_u32());
+  uint32_t column_count = header_reader.get_u32();
+  const auto &fields = frame_info_fields();
+  for (uint32_t i = 0; i < column_count; i++) {
+    std::string name(header_reader.get_u8(), '\0');
+    header_reader.get_bytes(&name[0], name.size());
+    Column column;
+    column.encoding = header_reader.get_u8();
+    column.field = nullptr;
+    for (const auto &field : fields) {
+      if (name == field.name) {
+        column.field = &field;
+      }
+    }
+    columns.push_back(column);
+  }
+
+  // footer
+  std::vector<uint8_t> footer = read_at(
+      footer_offset, static_cast<size_t>(size - trailer_size - footer_offset));
+  ByteReader footer_reader(footer);
+  read_sequence_info(footer_reader, sequence_info);
+  uint32_t block_count = footer_reader.get_u32();
+  for (uint32_t i = 0; i < block_count; i++) {
+    ArchiveBlock block;
+    block.offset = footer_reader.get_u64();
+    block.frame_count = footer_reader.get_u32();
+    block.pts_min = footer_reader.get_double();
+    block.pts_max = footer_reader.get_double();
+    index.push_back(block);
+  }
+}
+
+void ArchiveReader::read(
+    const std::function<void(const FrameInfo &)> &callback, double pts_start,
+    double pts_end) {
+  // frames without a PTS are only read when no range is requested
+  bool all = std::isinf(pts_start) && pts_start < 0 && std::isinf(pts_end) &&
+             pts_end > 0;
+  std::vector<FrameInfo> frames;
+  for (const auto &block : index) {
+    if (!all && !(block.pts_max >= pts_start && block.pts_min <= pts_end)) {
+      continue;
+    }
+    read_block(block, frames);
+    for (const auto &frame_info : frames) {
+      if (all || (frame_info.pts >= pts_start && frame_info.pts <= pts_end)) {
+        callback(frame_info);
+      }
+    }
+  }
+}
+
+void ArchiveReader::read_block(const ArchiveBlock &block,
+                               std::vector<FrameInfo> &frames) {
+  // columns are length-prefixed, so each one is read in a single call
+  file.clear();
+  file.seekg(static_cast<std::streamoff>(block.offset));
+
+  auto read_exact = [this](size_t size) {
+    std::vector<uint8_t> data(size);
+    if (!file.read(reinterpret_cast<char *>(data.data()), size)) {
+      throw std::runtime_error("Error reading archive: unexpected end of file");
+    }
+    return data;
+  };
+
+  std::vector<uint8_t> count_data = read_exact(4);
+  if (ByteReader(count_data).get_u32() != block.frame_count) {
+    throw std::runtime_error("Error reading archive: corrupt block");
+  }
+
+  frames.assign(block.frame_count, FrameInfo());
+  double seconds_per_tick = av_q2d(time_base);
+  for (const auto &column : columns) {
+    std::vector<uint8_t> length_data = read_exact(4);
+    uint32_t length = ByteReader(length_data).get_u32();
+    if (length > static_cast<uint64_t>(file_size)) {
+      throw std::runtime_error("Error reading archive: corrupt block");
+    }
+    std::vector<uint8_t> data = read_exact(length);
+    if (!column.field) {
+      continue;
+    }
+
+    BitReader reader(data.data(), data.size());
+    if (column.encoding == ENCODING_XOR) {
+      std::vector<double> values = decode_doubles(reader, block.frame_count);
+      for (uint32_t i = 0; i < block.frame_count; i++) {
+        column.field->set(frames[i], values[i]);
+      }
+    } else if (column.encoding == ENCODING_TIMESTAMP) {
+      std::vector<bool> present(block.frame_count, true);
+      if (reader.get_bits(1) == 1) {
+        for (uint32_t i = 0; i < block.frame_count; i++) {
+          present[i] = reader.get_bits(1) == 1;
+        }
+      }
+      std::vector<int64_t> values =
+          decode_integers(reader, block.frame_count, true);
+      for (uint32_t i = 0; i < block.frame_count; i++) {
+        // same computation as the parser: ticks * av_q2d(time_base)
+        column.field->set(frames[i],
+                          present[i] ? values[i] * seconds_per_tick : NAN);
+      }
+    } else {
+      std::vector<int64_t> values = decode_integers(
+          reader, block.frame_count, column.encoding != ENCODING_DELTA);
+      for (uint32_t i = 0; i < block.frame_count; i++) {
+        column.field->set(frames[i], static_cast<double>(values[i]));
+      }
+    }
+  }
+}
+
+} // namespace videoparser
@@ -0,0 +1,161 @@
+/**
+ * @file StatsArchive.h
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#ifndef VIDEOPARSER_STATS_ARCHIVE_H
+#define VIDEOPARSER_STATS_ARCHIVE_H
+
+#include "OutputWriter.h"
+#include "VideoParser.h"
+
+#include <cstdint>
+#include <fstream>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace videoparser {
+
+/**
+ * @brief Index entry of one block of frames in a statistics archive.
+ */
+struct ArchiveBlock {
+  uint64_t offset;      /**< Byte offset of the block in the archive */
+  uint32_t frame_count; /**< Number of frames in the block */
+  double pts_min;       /**< Smallest PTS of the frames in the block, NaN if
+                           no frame has a PTS */
+  double pts_max;       /**< Largest PTS of the frames in the block, NaN if
+                           no frame has a PTS */
+};
+
+/**
+ * @brief Writes FrameInfo records to a compact, block-indexed archive.
+ *
+ * Every field of FrameInfo (see frame_info_fields()) is stored as its own time
+ * series, compressed in the style of Facebook's Gorilla time series database:
+ *
+ * - `pts`/`dts` are converted to stream time base ticks and stored as
+ *   delta-of-delta, as are `frame_idx` and `current_poc`; missing timestamps
+ *   (NaN) are marked in a presence bitmap and read back as NaN
+ * - other integer fields are stored as deltas to the previous value
+ * - floating point fields are stored as XOR to the previous value
+ *
+ * Frames are grouped into blocks of block_size frames, in decoding order. An
+ * index with the PTS range of each block is written at the end of the file,
+ * together with the final SequenceInfo, so that ArchiveReader can decompress
+ * only the blocks that overlap a requested time range.
+ */
+class ArchiveWriter {
+public:
+  /**
+   * @brief Construct a new archive writer
+   *
+   * @param output Sink to write to; must stay valid until close() returns
+   * @param time_base Time base of the video stream, see
+   * VideoParser::get_time_base()
+   * @param block_size Number of frames per block
+   */
+  ArchiveWriter(OutputWriter &output, AVRational time_base,
+                uint32_t block_size = 4096);
+
+  /**
+   * @brief Append a frame to the archive
+   *
+   * @param frame_info The frame to append
+   */
+  void add_frame(const FrameInfo &frame_info);
+
+  /**
+   * @brief Write the remaining frames, the block index and the sequence info
+   *
+   * Does not close the underlying output.
+   *
+   * @param sequence_info The final sequence info, as returned by
+   * VideoParser::get_sequence_info() after parsing
+   */
+  void close(const SequenceInfo &sequence_info);
+
+private:
+  OutputWriter &output;
+  AVRational time_base;
+  uint32_t block_size;
+  uint64_t offset = 0;
+  std::vector<FrameInfo> pending;
+  std::vector<ArchiveBlock> index;
+
+  void write_bytes(const std::vector<uint8_t> &data);
+  void flush_block();
+};
+
+/**
+ * @brief Reads archives written by ArchiveWriter.
+ *
+ * The block index is loaded when the archive is opened. Frames are only
+ * decompressed for blocks whose PTS range overlaps the requested range.
+ * Archives must be uncompressed files for random access; decompress `.gz`
+ * archives before reading them.
+ */
+class ArchiveReader {
+public:
+  /**
+   * @brief Open an archive
+   *
+   * @param path Path of the archive file
+   * @throws std::runtime_error If the file cannot be read or is not a valid
+   * archive
+   */
+  ArchiveReader(const std::string &path);
+
+  /**
+   * @brief Get the sequence info stored in the archive
+   *
+   * @return const SequenceInfo& The sequence info
+   */
+  const SequenceInfo &get_sequence_info() const { return sequence_info; }
+
+  /**
+   * @brief Get the block index of the archive
+   *
+   * @return const std::vector<ArchiveBlock>& The blocks, in file order
+   */
+  const std::vector<ArchiveBlock> &get_blocks() const { return index; }
+
+  /**
+   * @brief Read all frames with a PTS within [pts_start, pts_end]
+   *
+   * Frames are passed to the callback in decoding order. Without arguments,
+   * all frames are read sequentially, including frames without a PTS, which
+   * never match a range.
+   *
+   * @param callback Called for every matching frame
+   * @param pts_start Start of the range in seconds (inclusive)
+   * @param pts_end End of the range in seconds (inclusive)
+   * @throws std::runtime_error If a block is corrupt
+   */
+  void read(const std::function<void(const FrameInfo &)> &callback,
+            double pts_start = -std::numeric_limits<double>::infinity(),
+            double pts_end = std::numeric_limits<double>::infinity());
+
+private:
+  std::ifstream file;
+  AVRational time_base;
+  SequenceInfo sequence_info;
+  struct Column {
+    uint8_t encoding;
+    const FrameInfoField *field; // nullptr if unknown to this version
+  };
+
+  std::ifstream::pos_type file_size;
+  std::vector<Column> columns;
+  std::vector<ArchiveBlock> index;
+
+  void read_block(const ArchiveBlock &block, std::vector<FrameInfo> &frames);
+};
+
+} // namespace videoparser
+
+#endif // VIDEOPARSER_STATS_ARCHIVE_H
@@ -0,0 +1,150 @@
+/**
+ * @file TemporalLayers.cpp
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#include "TemporalLayers.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace videoparser {
+
+namespace {
+
+// HEVC NAL unit types 0-31 are VCL (slice segment) units
+constexpr int HEVC_MAX_VCL_TYPE = 31;
+
+// AV1 OBU types that carry a frame header
+constexpr int AV1_OBU_TYPE_FRAME_HEADER = 3;
+constexpr int AV1_OBU_TYPE_FRAME = 6;
+constexpr int AV1_OBU_TYPE_REDUNDANT_FRAME_HEADER = 7;
+
+// keep the lowest temporal ID, with -1 for none
+int lowest(int current, int temporal_id) {
+  return current < 0 ? temporal_id : std::min(current, temporal_id);
+}
+
+} // namespace
+
+TemporalLayers::TemporalLayers(const AVCodecParameters *par)
+    : codec_id(par->codec_id) {
+  if (!is_supported(codec_id)) {
+    throw std::runtime_error(
+        "Temporal layers are only supported for HEVC and AV1");
+  }
+
+  // hvcC box: lengthSizeMinusOne in the low bits of byte 21; Annex B
+  // extradata starts with a start code instead of configurationVersion 1
+  if (codec_id == AV_CODEC_ID_HEVC && par->extradata_size > 22 &&
+      par->extradata[0] == 1) {
+    nal_length_size = (par->extradata[21] & 0x03) + 1;
+  }
+}
+
+bool TemporalLayers::is_supported(enum AVCodecID codec_id) {
+  return codec_id == AV_CODEC_ID_HEVC || codec_id == AV_CODEC_ID_AV1;
+}
+
+int TemporalLayers::packet_temporal_id(const uint8_t *data, int size) const {
+  if (!data || size <= 0) {
+    return -1;
+  }
+  if (codec_id == AV_CODEC_ID_HEVC) {
+    return hevc_temporal_id(data, size);
+  }
+  return av1_temporal_id(data, size);
+}
+
+int TemporalLayers::hevc_temporal_id(const uint8_t *data, int size) const {
+  int temporal_id = -1;
+
+  auto add_nal_unit = [&](const uint8_t *nal, int nal_size) {
+    if (nal_size < 2) {
+      return;
+    }
+    int nal_unit_type = (nal[0] >> 1) & 0x3f;
+    int nuh_temporal_id_plus1 = nal[1] & 0x07;
+    if (nal_unit_type <= HEVC_MAX_VCL_TYPE && nuh_temporal_id_plus1 > 0) {
+      temporal_id = lowest(temporal_id, nuh_temporal_id_plus1 - 1);
+    }
+  };
+
+  if (nal_length_size > 0) {
+    // MP4/Matroska: NAL units prefixed with their big-endian size
+    int pos = 0;
+    while (pos + nal_length_size <= size) {
+      int64_t nal_size = 0;
+      for (int i = 0; i < nal_length_size; i++) {
+        nal_size = (nal_size << 8) | data[pos + i];
+      }
+      pos += nal_length_size;
+      if (nal_size > size - pos) {
+        break; // truncated
+      }
+      add_nal_unit(data + pos, static_cast<int>(nal_size));
+      pos += static_cast<int>(nal_size);
+    }
+    return temporal_id;
+  }
+
+  // Annex B: NAL units follow 00 00 01 start codes; only the two header bytes
+  // are needed, so the end of each unit does not matter
+  for (int pos = 0; pos + 4 < size; pos++) {
+    if (data[pos] == 0 && data[pos + 1] == 0 && data[pos + 2] == 1) {
+      add_nal_unit(data + pos + 3, size - pos - 3);
+      pos += 2;
+    }
+  }
+  return temporal_id;
+}
+
+int TemporalLayers::av1_temporal_id(const uint8_t *data, int size) const {
+  int temporal_id = -1;
+  int pos = 0;
+
+  while (pos < size) {
+    uint8_t header = data[pos++];
+    int obu_type = (header >> 3) & 0x0f;
+    bool has_extension = (header >> 2) & 0x01;
+    bool has_size = (header >> 1) & 0x01;
+
+    int obu_temporal_id = 0;
+    if (has_extension) {
+      if (pos >= size) {
+        break;
+      }
+      obu_temporal_id = (data[pos++] >> 5) & 0x07;
+    }
+
+    // leb128 payload size; without it, the OBU extends to the end
+    int64_t obu_size = size - pos;
+    if (has_size) {
+      obu_size = 0;
+      for (int i = 0; i < 8; i++) {
+        if (pos >= size) {
+          return temporal_id;
+        }
+        uint8_t byte = data[pos++];
+        obu_size |= static_cast<int64_t>(byte & 0x7f) << (i * 7);
+        if (!(byte & 0x80)) {
+          break;
+        }
+      }
+    }
+
+    if (obu_type == AV1_OBU_TYPE_FRAME_HEADER || obu_type == AV1_OBU_TYPE_FRAME ||
+        obu_type == AV1_OBU_TYPE_REDUNDANT_FRAME_HEADER) {
+      temporal_id = lowest(temporal_id, obu_temporal_id);
+    }
+    if (obu_size > size - pos) {
+      break; // truncated
+    }
+    pos += static_cast<int>(obu_size);
+  }
+  return temporal_id;
+}
+
+} // namespace videoparser
@@ -0,0 +1,68 @@
+/**
+ * @file TemporalLayers.h
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#ifndef VIDEOPARSER_TEMPORAL_LAYERS_H
+#define VIDEOPARSER_TEMPORAL_LAYERS_H
+
+#include <cstdint>
+
+extern "C" {
+#include <libavcodec/codec_par.h>
+}
+
+namespace videoparser {
+
+/**
+ * @brief Reads the temporal IDs of HEVC and AV1 packets from their NAL unit
+ * and OBU headers.
+ *
+ * Pictures never reference pictures of a higher temporal layer, so packets
+ * above a chosen temporal ID can be dropped before decoding, and the
+ * remaining layers still decode correctly.
+ */
+class TemporalLayers {
+public:
+  /**
+   * @brief Construct a reader for a stream
+   *
+   * @param par The stream's codec parameters, for the codec and the NAL unit
+   * length size of HEVC in MP4/Matroska
+   * @throws std::runtime_error If the codec has no temporal IDs
+   */
+  explicit TemporalLayers(const AVCodecParameters *par);
+
+  /**
+   * @brief Whether temporal layers can be read for a codec
+   */
+  static bool is_supported(enum AVCodecID codec_id);
+
+  /**
+   * @brief Lowest temporal ID of the pictures in a packet
+   *
+   * For HEVC, this is `nuh_temporal_id_plus1 - 1` of the VCL NAL units. For
+   * AV1, it is the `temporal_id` of the OBU extension of the frame and frame
+   * header OBUs; OBUs without extension are in layer 0. A temporal unit with
+   * several frames (e.g. a hidden ARF and a shown frame) is kept if any of its
+   * frames is.
+   *
+   * @param data The packet data
+   * @param size The packet size
+   * @return int The temporal ID, or -1 if the packet has no picture
+   */
+  int packet_temporal_id(const uint8_t *data, int size) const;
+
+private:
+  enum AVCodecID codec_id;
+  int nal_length_size = 0; // HEVC only, 0 for Annex B start codes
+
+  int hevc_temporal_id(const uint8_t *data, int size) const;
+  int av1_temporal_id(const uint8_t *data, int size) const;
+};
+
+} // namespace videoparser
+
+#endif // VIDEOPARSER_TEMPORAL_LAYERS_H
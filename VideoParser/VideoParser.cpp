@@ -6,6 +6,10 @@
  */
 
 #include "VideoParser.h"
+#include "Statistics.h"
+
+#include <algorithm>
+#include <cmath>
 
 namespace videoparser {
 static bool verbose = false;
@@ -19,7 +23,185 @@ void set_verbose(bool verbose) {
   }
 }
 
-VideoParser::VideoParser(const char *filename) {
+template <typename T, T FrameInfo::*member>
+static double get_field(const FrameInfo &frame_info) {
+  return static_cast<double>(frame_info.*member);
+}
+
+template <typename T, T FrameInfo::*member>
+static void set_field(FrameInfo &frame_info, double value) {
+  frame_info.*member = static_cast<T>(value);
+}
+
+#define FRAME_INFO_FIELD(name, is_integer, metric)                             \
+  {#name, is_integer, metric,                                                  \
+   get_field<decltype(FrameInfo::name), &FrameInfo::name>,                     \
+   set_field<decltype(FrameInfo::name), &FrameInfo::name>}
+
+const std::vector<FrameInfoField> &frame_info_fields() {
+  static const std::vector<FrameInfoField> fields = {
+      FRAME_INFO_FIELD(frame_idx, true, 0),
+      FRAME_INFO_FIELD(dts, false, 0),
+      FRAME_INFO_FIELD(pts, false, 0),
+      FRAME_INFO_FIELD(size, true, 0),
+      FRAME_INFO_FIELD(frame_type, true, 0),
+      FRAME_INFO_FIELD(is_idr, true, 0),
+      FRAME_INFO_FIELD(qp_min, true, VIDEOPARSER_METRIC_QP),
+      FRAME_INFO_FIELD(qp_max, true, VIDEOPARSER_METRIC_QP),
+      FRAME_INFO_FIELD(qp_init, true, VIDEOPARSER_METRIC_QP),
+      FRAME_INFO_FIELD(qp_avg, false, VIDEOPARSER_METRIC_QP),
+      FRAME_INFO_FIELD(qp_stdev, false, VIDEOPARSER_METRIC_QP),
+      FRAME_INFO_FIELD(qp_bb_avg, false, VIDEOPARSER_METRIC_QP),
+      FRAME_INFO_FIELD(qp_bb_stdev, false, VIDEOPARSER_METRIC_QP),
+      FRAME_INFO_FIELD(motion_avg, false, VIDEOPARSER_METRIC_MOTION),
+      FRAME_INFO_FIELD(motion_stdev, false, VIDEOPARSER_METRIC_MOTION),
+      FRAME_INFO_FIELD(motion_x_avg, false, VIDEOPARSER_METRIC_MOTION),
+      FRAME_INFO_FIELD(motion_y_avg, false, VIDEOPARSER_METRIC_MOTION),
+      FRAME_INFO_FIELD(motion_x_stdev, false, VIDEOPARSER_METRIC_MOTION),
+      FRAME_INFO_FIELD(motion_y_stdev, false, VIDEOPARSER_METRIC_MOTION),
+      FRAME_INFO_FIELD(motion_diff_avg, false, VIDEOPARSER_METRIC_MOTION),
+      FRAME_INFO_FIELD(motion_diff_stdev, false, VIDEOPARSER_METRIC_MOTION),
+      FRAME_INFO_FIELD(current_poc, true, VIDEOPARSER_METRIC_POC),
+      FRAME_INFO_FIELD(poc_diff, true, VIDEOPARSER_METRIC_POC),
+      FRAME_INFO_FIELD(motion_bit_count, true, VIDEOPARSER_METRIC_BIT_COUNT),
+      FRAME_INFO_FIELD(coefs_bit_count, true, VIDEOPARSER_METRIC_BIT_COUNT),
+      FRAME_INFO_FIELD(mb_mv_count, true, VIDEOPARSER_METRIC_MOTION),
+      FRAME_INFO_FIELD(mv_coded_count, true, VIDEOPARSER_METRIC_MOTION),
+  };
+  return fields;
+}
+
+#undef FRAME_INFO_FIELD
+
+MetricSelection select_metrics(const std::string &list) {
+  static const std::pair<const char *, uint32_t> groups[] = {
+      {"qp", VIDEOPARSER_METRIC_QP},
+      {"motion", VIDEOPARSER_METRIC_MOTION},
+      {"bits", VIDEOPARSER_METRIC_BIT_COUNT},
+      {"poc", VIDEOPARSER_METRIC_POC},
+  };
+
+  MetricSelection selection;
+  auto add_field = [&selection](const FrameInfoField &field) {
+    for (const auto *selected : selection.fields) {
+      if (selected == &field) {
+        return;
+      }
+    }
+    selection.fields.push_back(&field);
+    selection.metrics_mask |= field.metric;
+  };
+
+  size_t start = 0;
+  while (start <= list.size()) {
+    size_t end = list.find(',', start);
+    if (end == std::string::npos) {
+      end = list.size();
+    }
+    std::string name = list.substr(start, end - start);
+    start = end + 1;
+    if (name.empty()) {
+      continue;
+    }
+
+    bool found = false;
+    for (const auto &group : groups) {
+      if (name == group.first) {
+        for (const auto &field : frame_info_fields()) {
+          if (field.metric == group.second) {
+            add_field(field);
+          }
+        }
+        found = true;
+      }
+    }
+    for (const auto &field : frame_info_fields()) {
+      if (name == field.name) {
+        add_field(field);
+        found = true;
+      }
+    }
+    if (!found) {
+      throw std::runtime_error("Unknown metric: " + name);
+    }
+  }
+
+  return selection;
+}
+
+MetricSelection select_metrics(uint32_t metrics_mask) {
+  MetricSelection selection;
+  selection.metrics_mask = metrics_mask;
+  for (const auto &field : frame_info_fields()) {
+    if (field.metric == 0 || (field.metric & metrics_mask)) {
+      selection.fields.push_back(&field);
+    }
+  }
+  return selection;
+}
+
+ParseMode parse_mode_from_name(const std::string &name) {
+  if (name == "full") {
+    return ParseMode::Full;
+  }
+  if (name == "headers") {
+    return ParseMode::Headers;
+  }
+  if (name == "packets") {
+    return ParseMode::Packets;
+  }
+  throw std::runtime_error("Unknown parse mode: " + name);
+}
+
+bool is_available(const FrameInfoField &field, ParseMode mode) {
+  switch (mode) {
+  case ParseMode::Full:
+    return true;
+  case ParseMode::Headers:
+    return field.metric == 0 || field.metric == VIDEOPARSER_METRIC_POC ||
+           strcmp(field.name, "qp_init") == 0;
+  case ParseMode::Packets:
+    return field.metric == 0 && strcmp(field.name, "frame_type") != 0;
+  }
+  return false;
+}
+
+MetricSelection restrict_metrics(const MetricSelection &selection,
+                                 ParseMode mode) {
+  MetricSelection restricted;
+  for (const FrameInfoField *field : selection.fields) {
+    if (is_available(*field, mode)) {
+      restricted.fields.push_back(field);
+      restricted.metrics_mask |= field->metric;
+    }
+  }
+  restricted.metrics_mask &= selection.metrics_mask;
+  return restricted;
+}
+
+RangePosition range_position_from_string(const std::string &text) {
+  RangePosition position;
+  std::string number = text;
+  if (!number.empty() && number.back() == 'f') {
+    position.is_frame = true;
+    number.pop_back();
+  }
+  size_t parsed = 0;
+  try {
+    position.value = std::stod(number, &parsed);
+  } catch (const std::exception &) {
+    parsed = 0;
+  }
+  if (number.empty() || parsed != number.size() ||
+      !std::isfinite(position.value) || position.value < 0 ||
+      (position.is_frame && position.value != std::floor(position.value))) {
+    throw std::runtime_error("Invalid range position: " + text);
+  }
+  return position;
+}
+
+VideoParser::VideoParser(const char *filename, const ParserOptions &options)
+    : options(options) {
   // Initialize FFmpeg networking
   avformat_network_init();
 
@@ -112,17 +294,45 @@ VideoParser::VideoParser(const char *filename) {
   sequence_info.video_bit_depth =
       av_pix_fmt_desc_get(codec_context->pix_fmt)->comp[0].depth;
 
-  AVDictionary *opts = nullptr;
-  // TODO: this is how we can get the motion vectors from ffmpeg, but only for
-  // H.264
-  // // https://ffmpeg.org/doxygen/trunk/extract_mvs_8c-example.html
-  // av_dict_set(&opts, "flags2", "+export_mvs", 0);
-
-  if (avcodec_open2(codec_context, codec, &opts) < 0) {
-    throw std::runtime_error("Error opening codec");
+  if (options.max_temporal_id >= 0) {
+    temporal_layers.emplace(codec_parameters);
+  }
+  if (options.sample_gops > 0 &&
+      (options.mode != ParseMode::Full || options.keyframes_only ||
+       options.max_temporal_id >= 0)) {
+    throw std::runtime_error("GOP sampling can only be used with the full "
+                             "parse mode, on all frames and layers");
+  }
+  if (options.sample_gops > 0 &&
+      (options.start.is_set() || options.end.is_set())) {
+    throw std::runtime_error("GOP sampling cannot be used with a range");
+  }
+  if (options.start.is_set() && options.end.is_set() &&
+      options.start.is_frame == options.end.is_frame &&
+      options.end.value <= options.start.value) {
+    throw std::runtime_error("The end of the range must be after its start");
+  }
+  if (options.write_index &&
+      (options.sample_gops > 0 || options.start.is_set() ||
+       options.end.is_set())) {
+    throw std::runtime_error(
+        "Writing the index requires reading all packets of the file");
   }
 
-  av_dict_free(&opts);
+  file_path = filename;
+  index_path = PacketIndex::path_for(filename);
+  if (options.use_index) {
+    load_packet_index();
+  }
+  if (options.write_index) {
+    int64_t file_size = format_context->pb ? avio_size(format_context->pb) : -1;
+    if (file_size < 0) {
+      throw std::runtime_error(
+          "Writing the index requires a file of known size");
+    }
+    index_writer.emplace(format_context->streams[video_stream_idx]->time_base,
+                         video_stream_idx, file_size);
+  }
 
   // Allocate packet and frame
   current_packet = av_packet_alloc();
@@ -134,6 +344,63 @@ VideoParser::VideoParser(const char *filename) {
   if (!frame) {
     throw std::runtime_error("Error allocating frame");
   }
+
+  if (options.mode == ParseMode::Packets && options.use_sample_table &&
+      !temporal_layers && !options.write_index) {
+    load_sample_table(filename);
+  }
+
+  // the sample table is read from the first sample on, without I/O
+  if (options.start.is_set() && !sample_table) {
+    seek_to_range_start();
+  }
+
+  // packets are only read from the demuxer, no decoder is needed
+  if (options.mode == ParseMode::Packets) {
+    return;
+  }
+
+  // without decoding, only FFmpeg's parser and the CBS header reader are
+  // needed; the parser reads the avcC/hvcC extradata from the unopened codec
+  // context
+  if (options.mode == ParseMode::Headers) {
+    parser = av_parser_init(codec_parameters->codec_id);
+    if (!parser) {
+      throw std::runtime_error("Header parsing is not supported for " +
+                               std::string(sequence_info.video_codec));
+    }
+    parser->flags |= PARSER_FLAG_COMPLETE_FRAMES;
+    if (options.metrics & VIDEOPARSER_METRIC_QP) {
+      cbs_headers = videoparser_cbs_headers_open(codec_parameters);
+    }
+    return;
+  }
+
+  AVDictionary *opts = nullptr;
+  // TODO: this is how we can get the motion vectors from ffmpeg, but only for
+  // H.264
+  // // https://ffmpeg.org/doxygen/trunk/extract_mvs_8c-example.html
+  // av_dict_set(&opts, "flags2", "+export_mvs", 0);
+
+  // FFmpeg's decoders skip non-key frames that are sent anyway, e.g. if the
+  // container does not flag key frames
+  if (options.keyframes_only) {
+    codec_context->skip_frame = AVDISCARD_NONKEY;
+  }
+
+  // the statistics hooks of all decoders update the frame's SharedFrameInfo
+  // directly, so they are not safe with multiple threads
+  codec_context->thread_count = 1;
+
+  if (avcodec_open2(codec_context, codec, &opts) < 0) {
+    throw std::runtime_error("Error opening codec");
+  }
+
+  av_dict_free(&opts);
+
+  if (options.sample_gops > 0) {
+    init_gop_sampling();
+  }
 }
 
 /**
@@ -160,14 +427,52 @@ SequenceInfo VideoParser::get_sequence_info() {
       sequence_info.video_frame_count = frame_idx;
     }
 
-    // convert via packet size sum (in bytes) to kbit/s
-    sequence_info.video_bitrate =
-        packet_size_sum * 8 / 1000 / sequence_info.video_duration;
+    // convert via packet size sum (in bytes) to kbit/s; when sampling GOPs,
+    // only the index covers all packets, otherwise keep the container's
+    // bitrate
+    if (options.sample_gops == 0) {
+      sequence_info.video_bitrate =
+          packet_size_sum * 8 / 1000 / sequence_info.video_duration;
+    } else if (index_size_sum > 0) {
+      sequence_info.video_bitrate =
+          index_size_sum * 8 / 1000 / sequence_info.video_duration;
+    }
+  }
+
+  // with a range, describe the returned frames rather than the file
+  if ((options.start.is_set() || options.end.is_set()) &&
+      range_frame_count > 0) {
+    double frame_duration = sequence_info.video_framerate > 0
+                                ? 1 / sequence_info.video_framerate
+                                : 0;
+    sequence_info.video_duration =
+        range_last_pts - range_first_pts + frame_duration;
+    sequence_info.video_frame_count = range_frame_count;
+    if (sequence_info.video_duration > 0) {
+      sequence_info.video_bitrate =
+          range_size_sum * 8 / 1000 / sequence_info.video_duration;
+    }
+  }
+
+  if (gop_estimator) {
+    sequence_info.sampled_gop_count = gop_estimator->gop_count();
+    const auto &fields = frame_info_fields();
+    sequence_info.estimates.assign(fields.size(), MetricEstimate{0, NAN, NAN});
+    for (size_t i = 0; i < fields.size(); i++) {
+      if (SequenceAggregator::is_aggregated(fields[i])) {
+        sequence_info.estimates[i] =
+            gop_estimator->estimate(i, sequence_info.gop_count);
+      }
+    }
   }
 
   return sequence_info;
 }
 
+AVRational VideoParser::get_time_base() const {
+  return format_context->streams[video_stream_idx]->time_base;
+}
+
 /**
  * @brief Set the frame info struct from current ffmpeg frame and packet
  *
@@ -179,6 +484,16 @@ void VideoParser::set_frame_info(FrameInfo &frame_info) {
         "Error setting frame info, did you call parse_frame() before?");
   }
 
+  // the side data is allocated by the decoder fork, which may have been built
+  // with a shared.h that has fewer fields
+  const AVFrameSideData *side_data =
+      av_frame_get_side_data(frame, AV_FRAME_DATA_VIDEOPARSER_INFO);
+  if (side_data && side_data->size < sizeof(SharedFrameInfo)) {
+    throw std::runtime_error(
+        "Shared frame info of the decoder is too small, was FFmpeg built with "
+        "an older shared.h?");
+  }
+
   // get the SharedFrameInfo, sometimes it's empty, so we skip this iteration
   SharedFrameInfo *shared_frame_info =
       videoparser_get_final_shared_frame_info(frame);
@@ -197,8 +512,15 @@ void VideoParser::set_frame_info(FrameInfo &frame_info) {
   // set first and last pts to calculate video duration at the end
   if (frame_idx == 0) {
     first_pts = pts;
+    last_pts = pts;
   }
-  last_pts = pts;
+  // skipped packets may already have moved last_pts past this frame
+  last_pts = std::max(last_pts, pts);
+
+  // count the skipped frames that are presented before this one
+  auto presented_before = skipped_pts.lower_bound(pts);
+  frame_idx += std::distance(skipped_pts.begin(), presented_before);
+  skipped_pts.erase(skipped_pts.begin(), presented_before);
 
   // count general size statistics
   packet_size_sum += current_packet->size;
@@ -250,6 +572,16 @@ void VideoParser::set_frame_info(FrameInfo &frame_info) {
   frame_info.coefs_bit_count = shared_frame_info->coefs_bit_count;
   frame_info.mv_coded_count = shared_frame_info->mv_coded_count;
 
+  // the decoder always computes all metrics, clear those that were not
+  // requested
+  if (options.metrics != VIDEOPARSER_METRIC_ALL) {
+    for (const auto &field : frame_info_fields()) {
+      if (field.metric && !(field.metric & options.metrics)) {
+        field.set(frame_info, 0);
+      }
+    }
+  }
+
   // Adding these to make debugging easier
   // frame_info.mv_length = shared_frame_info->mv_length;
   // frame_info.mv_sum_sqr = shared_frame_info->mv_sum_sqr;
@@ -276,6 +608,83 @@ void VideoParser::set_frame_info(FrameInfo &frame_info) {
   frame_idx++;
 }
 
+/**
+ * @brief Set the frame info struct from the current packet, without looking
+ * at its data
+ *
+ * @param frame_info
+ */
+void VideoParser::set_frame_info_from_packet(FrameInfo &frame_info) {
+  double time_base =
+      av_q2d(format_context->streams[video_stream_idx]->time_base);
+  int64_t pts = current_packet->pts != AV_NOPTS_VALUE ? current_packet->pts
+                                                      : current_packet->dts;
+  int64_t dts = current_packet->dts != AV_NOPTS_VALUE ? current_packet->dts
+                                                      : current_packet->pts;
+
+  frame_info = FrameInfo{};
+  frame_info.frame_idx = frame_idx;
+  frame_info.pts = pts != AV_NOPTS_VALUE ? pts * time_base : NAN;
+  frame_info.dts = dts != AV_NOPTS_VALUE ? dts * time_base : NAN;
+  frame_info.size = current_packet->size;
+  frame_info.is_idr = (current_packet->flags & AV_PKT_FLAG_KEY) != 0;
+
+  // packets are in decoding order, so the duration spans the smallest to the
+  // largest presentation timestamp
+  if (std::isfinite(frame_info.pts)) {
+    if (frame_idx == 0 || frame_info.pts < first_pts) {
+      first_pts = frame_info.pts;
+    }
+    if (frame_idx == 0 || frame_info.pts > last_pts) {
+      last_pts = frame_info.pts;
+    }
+  }
+  packet_size_sum += current_packet->size;
+}
+
+/**
+ * @brief Add the information from the headers of the current packet to the
+ * frame info struct
+ *
+ * @param frame_info
+ */
+void VideoParser::set_frame_info_from_headers(FrameInfo &frame_info) {
+  // the packets are complete frames, so the parser returns them right away
+  uint8_t *data = nullptr;
+  int size = 0;
+  av_parser_parse2(parser, codec_context, &data, &size, current_packet->data,
+                   current_packet->size, current_packet->pts,
+                   current_packet->dts, current_packet->pos);
+
+  if (parser->pict_type == AV_PICTURE_TYPE_I) {
+    frame_info.frame_type = I;
+  } else if (parser->pict_type == AV_PICTURE_TYPE_P) {
+    frame_info.frame_type = P;
+  } else if (parser->pict_type == AV_PICTURE_TYPE_B) {
+    frame_info.frame_type = B;
+  }
+  // the parser sets key_frame to -1 if it cannot tell, keep the packet flag
+  if (parser->key_frame >= 0) {
+    frame_info.is_idr = parser->key_frame == 1;
+  }
+
+  // only the H.264 and HEVC parsers compute the POC
+  if ((options.metrics & VIDEOPARSER_METRIC_POC) &&
+      (codec_context->codec_id == AV_CODEC_ID_H264 ||
+       codec_context->codec_id == AV_CODEC_ID_H265)) {
+    frame_info.current_poc = parser->output_picture_number;
+    frame_info.poc_diff = frame_idx > 0 ? frame_info.current_poc - last_poc : 0;
+    last_poc = frame_info.current_poc;
+  }
+
+  int qp_init = 0;
+  if (cbs_headers &&
+      videoparser_cbs_headers_read_qp(cbs_headers, current_packet, &qp_init) >
+          0) {
+    frame_info.qp_init = qp_init;
+  }
+}
+
 void VideoParser::print_shared_frame_info(SharedFrameInfo &shared_frame_info) {
   std::cerr << "================ SHARED FRAME INFO ================"
             << std::endl;
@@ -346,6 +755,47 @@ void VideoParser::set_frame_info_h265(FrameInfo &frame_info) {}
 void VideoParser::set_frame_info_vp9(FrameInfo &frame_info) {}
 void VideoParser::set_frame_info_av1(FrameInfo &frame_info) {}
 
+/**
+ * @brief With ParserOptions::keyframes_only or max_temporal_id, count a packet
+ * of the video stream that is not to be decoded
+ *
+ * Skipped packets are not sent to the decoder at all, which also covers
+ * decoders that ignore skip_frame, such as libaom. They still count towards
+ * the frame index and the bitrate. When decoding, the decoder may still hold
+ * back frames that precede them in presentation order, so they are only
+ * counted in frame_idx once a later frame is returned (see set_frame_info()).
+ *
+ * @return true If the packet is to be skipped
+ */
+bool VideoParser::skip_packet() {
+  bool skip = false;
+  if (options.keyframes_only) {
+    skip = !(current_packet->flags & AV_PKT_FLAG_KEY);
+  }
+  if (!skip && temporal_layers) {
+    skip = temporal_layers->packet_temporal_id(current_packet->data,
+                                               current_packet->size) >
+           options.max_temporal_id;
+  }
+  if (!skip) {
+    return false;
+  }
+
+  double pts = current_packet->pts * av_q2d(get_time_base());
+  // keep the fallback duration of get_sequence_info() spanning all frames
+  if (frame_idx > 0 && current_packet->pts != AV_NOPTS_VALUE) {
+    last_pts = std::max(last_pts, pts);
+  }
+  packet_size_sum += current_packet->size;
+  if (options.mode == ParseMode::Full &&
+      current_packet->pts != AV_NOPTS_VALUE) {
+    skipped_pts.insert(pts);
+  } else {
+    frame_idx++;
+  }
+  return true;
+}
+
 /**
  * @brief Parse a single frame and set the frame_info struct
  *
@@ -354,15 +804,32 @@ void VideoParser::set_frame_info_av1(FrameInfo &frame_info) {}
  * @return false If no frame was parsed (stop parsing)
  */
 bool VideoParser::parse_frame(FrameInfo &frame_info) {
+  if (is_range_done) {
+    return false;
+  }
+  if (options.mode != ParseMode::Full) {
+    return parse_packet(frame_info);
+  }
+  if (options.sample_gops > 0) {
+    return parse_sampled_frame(frame_info);
+  }
+
   while (av_read_frame(format_context, current_packet) == 0) {
     if (current_packet->stream_index == video_stream_idx) {
+      on_video_packet();
+    }
+    if (current_packet->stream_index == video_stream_idx &&
+        !skip_packet()) {
       if (avcodec_send_packet(codec_context, current_packet) == 0) {
-        while (avcodec_receive_frame(codec_context, frame) == 0) {
+        // decode each key frame on its own, so that the decoder does not hold
+        // it back until the next key frame
+        if (options.keyframes_only) {
+          avcodec_send_packet(codec_context, nullptr);
+        }
+        bool frame_set = false;
+        while (!frame_set && avcodec_receive_frame(codec_context, frame) == 0) {
           try {
             set_frame_info(frame_info);
-            // only unref and return true if we successfully set frame info
-            av_packet_unref(current_packet);
-            return true;
           } catch (const std::exception &e) {
             if (verbose) {
               std::cerr << "Warning: Could not set frame info for frame index "
@@ -371,6 +838,26 @@ bool VideoParser::parse_frame(FrameInfo &frame_info) {
             // continue to next frame if we couldn't set frame info
             continue;
           }
+          // frames are in presentation order, so all later ones are past the
+          // end, too
+          if (is_after_range(frame_info.frame_idx, frame_info.pts)) {
+            is_range_done = true;
+            break;
+          }
+          // frames before the start are only decoded as references
+          frame_set = !is_before_range(frame_info.frame_idx, frame_info.pts);
+        }
+        if (options.keyframes_only) {
+          avcodec_flush_buffers(codec_context);
+        }
+        // only unref and return true if we successfully set frame info
+        if (frame_set) {
+          add_range_frame(frame_info);
+          av_packet_unref(current_packet);
+          return true;
+        }
+        if (is_range_done) {
+          break;
         }
       }
     }
@@ -378,15 +865,740 @@ bool VideoParser::parse_frame(FrameInfo &frame_info) {
   }
 
   // Free the packet, no more frames
+  frame_idx += skipped_pts.size();
+  skipped_pts.clear();
+  av_packet_free(&current_packet);
+  write_packet_index();
+  return false;
+}
+
+/**
+ * @brief Read the next packet and set the frame_info struct, without decoding
+ * it
+ *
+ * @param frame_info The frame_info struct to be set
+ * @return true If a packet was read and the frame_info struct was set
+ * @return false If there are no more packets
+ */
+bool VideoParser::parse_packet(FrameInfo &frame_info) {
+  while (read_packet()) {
+    if (current_packet->stream_index == video_stream_idx) {
+      on_video_packet();
+    }
+    if (current_packet->stream_index == video_stream_idx &&
+        !skip_packet()) {
+      set_frame_info_from_packet(frame_info);
+      if (options.mode == ParseMode::Headers) {
+        set_frame_info_from_headers(frame_info);
+      }
+      frame_idx++;
+      av_packet_unref(current_packet);
+      // packets are in decoding order, so all later ones are past the end
+      if (is_after_range(frame_info.frame_idx, frame_info.dts)) {
+        is_range_done = true;
+        break;
+      }
+      if (!is_before_range(frame_info.frame_idx, frame_info.pts) &&
+          !is_after_range(frame_info.frame_idx, frame_info.pts)) {
+        add_range_frame(frame_info);
+        return true;
+      }
+      continue;
+    }
+    av_packet_unref(current_packet);
+  }
+
   av_packet_free(&current_packet);
+  if (!is_range_done) {
+    write_packet_index();
+  }
   return false;
 }
 
+/**
+ * @brief Read the sample table of an MP4/MOV file, for
+ * ParserOptions::use_sample_table
+ *
+ * FFmpeg's MOV demuxer has already built its index from the same tables, and
+ * for fragmented files from the movie fragments it read while opening the
+ * file, so the sample table is only used if it lists the same packets with the
+ * same decoding timestamps and key frame flags, up to the last entry of a
+ * fragmented file's index. This also confirms that the edit list was applied
+ * in the same way. Otherwise, and if the boxes cannot be read, the packets are
+ * read from the demuxer.
+ *
+ * @param filename The file that was opened
+ */
+void VideoParser::load_sample_table(const char *filename) {
+  if (!strstr(format_context->iformat->name, "mp4")) {
+    return;
+  }
+  std::optional<Mp4SampleTable> table;
+  try {
+    table = Mp4SampleTable::read(filename, video_stream_idx);
+  } catch (const std::exception &e) {
+    if (verbose) {
+      std::cerr << "Warning: could not read the MP4 sample table: " << e.what()
+                << std::endl;
+    }
+    return;
+  }
+  AVStream *stream = format_context->streams[video_stream_idx];
+  if (!table || stream->time_base.num != 1 ||
+      stream->time_base.den != static_cast<int>(table->get_timescale())) {
+    return;
+  }
+
+  const std::vector<Mp4Sample> &samples = table->get_samples();
+  int entry_count = avformat_index_get_entries_count(stream);
+  int sample_count = static_cast<int>(samples.size());
+  // the demuxer may not have read all fragments yet, but at least the first
+  bool is_same = table->is_fragmented()
+                     ? entry_count > 0 && entry_count <= sample_count
+                     : entry_count == sample_count;
+  for (int i = 0; is_same && i < entry_count; i++) {
+    const AVIndexEntry *entry = avformat_index_get_entry(stream, i);
+    is_same = entry->timestamp == samples[i].dts &&
+              entry->size == static_cast<int>(samples[i].size) &&
+              ((entry->flags & AVINDEX_KEYFRAME) != 0) == samples[i].is_sync;
+  }
+  if (!is_same) {
+    if (verbose) {
+      std::cerr << "Warning: the MP4 sample table does not match the "
+                   "demuxer, reading all packets"
+                << std::endl;
+    }
+    return;
+  }
+
+  if (sequence_info.video_frame_count == 0) {
+    sequence_info.video_frame_count = samples.size();
+  }
+  sample_table = std::move(table);
+}
+
+/**
+ * @brief Read the next packet of the file into current_packet
+ *
+ * With a sample table, the next packet of the video stream is set from it,
+ * without data.
+ *
+ * @return true If a packet was read
+ * @return false If there are no more packets
+ */
+bool VideoParser::read_packet() {
+  if (!sample_table) {
+    return av_read_frame(format_context, current_packet) == 0;
+  }
+  const std::vector<Mp4Sample> &samples = sample_table->get_samples();
+  if (sample_idx >= samples.size()) {
+    return false;
+  }
+  const Mp4Sample &sample = samples[sample_idx++];
+  av_packet_unref(current_packet);
+  current_packet->stream_index = video_stream_idx;
+  current_packet->pts = sample.pts;
+  current_packet->dts = sample.dts;
+  current_packet->pos = -1;
+  current_packet->size = static_cast<int>(sample.size);
+  current_packet->flags = sample.is_sync ? AV_PKT_FLAG_KEY : 0;
+  return true;
+}
+
+/**
+ * @brief Whether the index lists every packet of the video stream
+ *
+ * This is the case for the MP4 sample tables and a loaded sidecar index, but
+ * not for the key frame cues of Matroska. Only then does the position of an
+ * entry give the frame index of its packet.
+ */
+bool VideoParser::is_full_index() const {
+  if (packet_index) {
+    return true;
+  }
+  AVStream *stream = format_context->streams[video_stream_idx];
+  int entry_count = avformat_index_get_entries_count(stream);
+  return entry_count > 0 && entry_count == stream->nb_frames;
+}
+
+/**
+ * @brief Get the frame index of the current packet, e.g. after a seek
+ *
+ * Exact if the index lists every packet, otherwise estimated from the
+ * presentation timestamp and the frame rate.
+ *
+ * @return int64_t The zero-based frame index
+ */
+int64_t VideoParser::packet_frame_idx() {
+  AVStream *stream = format_context->streams[video_stream_idx];
+  if (packet_index) {
+    int64_t entry_idx = packet_index->find_pos(current_packet->pos);
+    if (entry_idx >= 0) {
+      return entry_idx;
+    }
+  } else if (is_full_index() && current_packet->dts != AV_NOPTS_VALUE) {
+    int entry_idx = av_index_search_timestamp(stream, current_packet->dts,
+                                              AVSEEK_FLAG_BACKWARD);
+    if (entry_idx >= 0 &&
+        avformat_index_get_entry(stream, entry_idx)->timestamp ==
+            current_packet->dts) {
+      return entry_idx;
+    }
+  }
+  int64_t pts = current_packet->pts != AV_NOPTS_VALUE ? current_packet->pts
+                                                      : current_packet->dts;
+  int64_t start =
+      stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+  return std::max<int64_t>(
+      0, std::llround((pts - start) * av_q2d(stream->time_base) *
+                      sequence_info.video_framerate));
+}
+
+/**
+ * @brief Load the sidecar index of the file, for ParserOptions::use_index
+ *
+ * The index is ignored if the container already lists every packet, and with
+ * a warning if it was written for another version of the file, i.e. one with
+ * another size or other bytes at the first or last packet. Its entries
+ * are also added to FFmpeg's index of the stream, which the demuxers without
+ * an index of their own (e.g. MPEG-TS and raw streams) seek in.
+ */
+void VideoParser::load_packet_index() {
+  if (is_full_index()) {
+    return;
+  }
+  std::optional<PacketIndex> index = PacketIndex::read(index_path);
+  if (!index) {
+    return;
+  }
+
+  AVStream *stream = format_context->streams[video_stream_idx];
+  int64_t file_size = format_context->pb ? avio_size(format_context->pb) : -1;
+  if (index->get_file_size() != file_size ||
+      index->get_stream_index() != video_stream_idx ||
+      av_cmp_q(index->get_time_base(), stream->time_base) != 0 ||
+      index->get_packet_hash() != index->hash_packets(file_path)) {
+    std::cerr << "Warning: ignoring the index " << index_path
+              << ", which does not match the file" << std::endl;
+    return;
+  }
+
+  for (const PacketIndexEntry &entry : index->get_entries()) {
+    int64_t timestamp = entry.dts != AV_NOPTS_VALUE ? entry.dts : entry.pts;
+    if (entry.pos >= 0 && timestamp != AV_NOPTS_VALUE) {
+      av_add_index_entry(stream, entry.pos, timestamp, entry.size, 0,
+                         entry.is_key ? AVINDEX_KEYFRAME : 0);
+    }
+  }
+  if (sequence_info.video_frame_count == 0) {
+    sequence_info.video_frame_count = index->get_entries().size();
+  }
+  packet_index = std::move(index);
+}
+
+/**
+ * @brief Handle a packet of the video stream before it is parsed
+ *
+ * After seeking to the start of the range, sets frame_idx from the first
+ * packet, and adds every packet to the index to be written.
+ */
+void VideoParser::on_video_packet() {
+  if (is_seek_pending) {
+    frame_idx = packet_frame_idx();
+    is_seek_pending = false;
+  }
+  if (index_writer) {
+    index_writer->add(*current_packet);
+  }
+}
+
+/**
+ * @brief Write the sidecar index once all packets were read, for
+ * ParserOptions::write_index
+ */
+void VideoParser::write_packet_index() {
+  if (index_writer) {
+    index_writer->set_packet_hash(index_writer->hash_packets(file_path));
+    index_writer->write(index_path);
+    index_writer.reset();
+  }
+}
+
+/**
+ * @brief Seek to the key frame at or before a timestamp
+ *
+ * With a sidecar index, seeks directly to the byte offset of the key frame,
+ * unless the demuxer cannot seek by bytes or only derives the timestamps from
+ * the start of the stream.
+ *
+ * @param timestamp The timestamp in the stream time base
+ */
+void VideoParser::seek_to_key_frame(int64_t timestamp) {
+  int flags = format_context->iformat->flags;
+  if (packet_index && !(flags & (AVFMT_NO_BYTE_SEEK | AVFMT_NOTIMESTAMPS))) {
+    const PacketIndexEntry *key_entry = nullptr;
+    for (const PacketIndexEntry &entry : packet_index->get_entries()) {
+      int64_t entry_ts = entry.dts != AV_NOPTS_VALUE ? entry.dts : entry.pts;
+      if (entry_ts != AV_NOPTS_VALUE && entry_ts > timestamp && key_entry) {
+        break;
+      }
+      if (entry.is_key && entry.pos >= 0) {
+        key_entry = &entry;
+      }
+    }
+    if (key_entry && av_seek_frame(format_context, video_stream_idx,
+                                   key_entry->pos, AVSEEK_FLAG_BYTE) >= 0) {
+      return;
+    }
+  }
+  if (av_seek_frame(format_context, video_stream_idx, timestamp,
+                    AVSEEK_FLAG_BACKWARD) < 0) {
+    throw std::runtime_error("Error seeking to a key frame");
+  }
+}
+
+/**
+ * @brief Convert a position to a timestamp to seek to
+ *
+ * A frame index is converted to the timestamp of its index entry, if the
+ * index lists every packet, or else to its nominal time at the average frame
+ * rate.
+ *
+ * @param position The position
+ * @return int64_t The timestamp in the stream time base
+ */
+int64_t VideoParser::position_timestamp(const RangePosition &position) {
+  AVStream *stream = format_context->streams[video_stream_idx];
+  double time_base = av_q2d(stream->time_base);
+  if (!position.is_frame) {
+    return std::llround(position.value / time_base);
+  }
+  if (packet_index) {
+    const auto &entries = packet_index->get_entries();
+    const PacketIndexEntry &entry = entries[static_cast<size_t>(
+        std::min<double>(position.value, entries.size() - 1))];
+    return entry.dts != AV_NOPTS_VALUE ? entry.dts : entry.pts;
+  }
+  if (is_full_index()) {
+    int entry_idx = static_cast<int>(std::min<double>(
+        position.value, avformat_index_get_entries_count(stream) - 1));
+    return avformat_index_get_entry(stream, entry_idx)->timestamp;
+  }
+  if (sequence_info.video_framerate <= 0) {
+    throw std::runtime_error("A frame position requires a known frame rate");
+  }
+  int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time : 0;
+  return start + std::llround(position.value / sequence_info.video_framerate /
+                              time_base);
+}
+
+/**
+ * @brief Seek to the key frame at or before ParserOptions::start
+ */
+void VideoParser::seek_to_range_start() {
+  seek_to_key_frame(position_timestamp(options.start));
+  is_seek_pending = true;
+}
+
+/**
+ * @brief Whether a frame is before ParserOptions::start
+ *
+ * @param idx The frame index
+ * @param time The presentation timestamp in seconds
+ */
+bool VideoParser::is_before_range(int64_t idx, double time) const {
+  if (!options.start.is_set()) {
+    return false;
+  }
+  return options.start.is_frame ? idx < options.start.value
+                                : time < options.start.value;
+}
+
+/**
+ * @brief Whether a frame is at or after ParserOptions::end
+ *
+ * @param idx The frame index
+ * @param time The presentation (or, in decoding order, decoding) timestamp in
+ * seconds
+ */
+bool VideoParser::is_after_range(int64_t idx, double time) const {
+  if (!options.end.is_set()) {
+    return false;
+  }
+  return options.end.is_frame ? idx >= options.end.value
+                              : time >= options.end.value;
+}
+
+/**
+ * @brief Count a returned frame for the sequence info of the range
+ */
+void VideoParser::add_range_frame(const FrameInfo &frame_info) {
+  if (range_frame_count == 0 || frame_info.pts < range_first_pts) {
+    range_first_pts = frame_info.pts;
+  }
+  if (range_frame_count == 0 || frame_info.pts > range_last_pts) {
+    range_last_pts = frame_info.pts;
+  }
+  range_size_sum += frame_info.size;
+  range_frame_count++;
+}
+
+/**
+ * @brief Choose the GOPs to decode for ParserOptions::sample_gops
+ *
+ * The container index lists the key frames without reading them; if it lists
+ * every packet with its size (e.g. the MP4 sample tables or the sidecar
+ * index), it also gives the frame indices and the bitrate. Without an index
+ * (e.g. MPEG-TS), timestamps spread over the duration are sampled instead, and
+ * each seek lands on the preceding key frame.
+ */
+void VideoParser::init_gop_sampling() {
+  AVStream *stream = format_context->streams[video_stream_idx];
+
+  std::vector<int> key_entries;
+  int entry_count = avformat_index_get_entries_count(stream);
+  for (int i = 0; i < entry_count; i++) {
+    const AVIndexEntry *entry = avformat_index_get_entry(stream, i);
+    if (entry->flags & AVINDEX_KEYFRAME) {
+      key_entries.push_back(i);
+    }
+  }
+  if (!key_entries.empty()) {
+    for (uint64_t position :
+         sample_positions(key_entries.size(), options.sample_gops,
+                          options.sample_method, options.sample_seed)) {
+      sampled_gops.push_back(
+          avformat_index_get_entry(stream, key_entries[position])->timestamp);
+    }
+    sequence_info.gop_count = key_entries.size();
+    if (packet_index) {
+      for (const PacketIndexEntry &entry : packet_index->get_entries()) {
+        index_size_sum += entry.size;
+      }
+    } else if (is_full_index()) {
+      for (int i = 0; i < entry_count; i++) {
+        index_size_sum += avformat_index_get_entry(stream, i)->size;
+      }
+    }
+  } else {
+    double time_base = av_q2d(stream->time_base);
+    int64_t start = stream->start_time != AV_NOPTS_VALUE ? stream->start_time
+                                                         : 0;
+    int64_t duration = stream->duration;
+    if (duration <= 0 && sequence_info.video_duration > 0) {
+      duration =
+          static_cast<int64_t>(sequence_info.video_duration / time_base);
+    }
+    if (duration <= 0) {
+      throw std::runtime_error("GOP sampling requires a known duration");
+    }
+    for (uint64_t position :
+         sample_positions(duration, options.sample_gops, options.sample_method,
+                          options.sample_seed)) {
+      sampled_gops.push_back(start + static_cast<int64_t>(position));
+    }
+  }
+
+  // the fallback of get_sequence_info() would only count the sampled frames
+  if (sequence_info.video_frame_count == 0) {
+    sequence_info.video_frame_count = static_cast<uint32_t>(std::llround(
+        sequence_info.video_duration * sequence_info.video_framerate));
+  }
+
+  gop_estimator.emplace(frame_info_fields().size());
+}
+
+/**
+ * @brief With ParserOptions::sample_gops, parse the next frame of the sampled
+ * GOPs
+ *
+ * Seeks to the key frame of each sampled GOP in turn and sends its packets up
+ * to the next key frame. The decoder is then drained, so that the GOP's last
+ * frames are returned as well, and flushed before the next seek.
+ *
+ * @param frame_info The frame_info struct to be set
+ * @return true If a frame was parsed and the frame_info struct was set
+ * @return false If all sampled GOPs were parsed
+ */
+bool VideoParser::parse_sampled_frame(FrameInfo &frame_info) {
+  for (;;) {
+    if (receive_sampled_frame(frame_info)) {
+      return true;
+    }
+
+    if (gop_draining) {
+      avcodec_flush_buffers(codec_context);
+      gop_estimator->end_gop();
+      gop_draining = false;
+      gop_started = false;
+      sampled_gop_idx++;
+    }
+
+    if (!gop_started) {
+      if (sampled_gop_idx >= sampled_gops.size()) {
+        av_packet_free(&current_packet);
+        return false;
+      }
+      seek_to_key_frame(sampled_gops[sampled_gop_idx]);
+      gop_started = true;
+      gop_frame_count = 0;
+      gop_packet_sizes.clear();
+    }
+
+    av_packet_unref(current_packet);
+    if (av_read_frame(format_context, current_packet) < 0) {
+      // the end of the file ends the last GOP
+      avcodec_send_packet(codec_context, nullptr);
+      gop_draining = true;
+      continue;
+    }
+    if (current_packet->stream_index != video_stream_idx) {
+      continue;
+    }
+
+    bool is_key = current_packet->flags & AV_PKT_FLAG_KEY;
+    if (gop_packet_sizes.empty()) {
+      // without an index, two sampled timestamps can fall into the same GOP
+      if (current_packet->dts != AV_NOPTS_VALUE &&
+          current_packet->dts <= gop_key_dts) {
+        gop_started = false;
+        sampled_gop_idx++;
+        continue;
+      }
+      gop_key_dts = current_packet->dts;
+      gop_first_frame_idx = packet_frame_idx();
+    } else if (is_key) {
+      // the next GOP starts
+      avcodec_send_packet(codec_context, nullptr);
+      gop_draining = true;
+      continue;
+    }
+
+    gop_packet_sizes[current_packet->pts] = current_packet->size;
+    avcodec_send_packet(codec_context, current_packet);
+  }
+}
+
+/**
+ * @brief Receive the next frame of the current sampled GOP from the decoder
+ * and add it to the estimates
+ *
+ * @param frame_info The frame_info struct to be set
+ * @return true If a frame was received and the frame_info struct was set
+ * @return false If the decoder needs more packets or is drained
+ */
+bool VideoParser::receive_sampled_frame(FrameInfo &frame_info) {
+  while (avcodec_receive_frame(codec_context, frame) == 0) {
+    frame_idx = gop_first_frame_idx + gop_frame_count++;
+    try {
+      set_frame_info(frame_info);
+    } catch (const std::exception &e) {
+      if (verbose) {
+        std::cerr << "Warning: Could not set frame info for frame index "
+                  << frame_idx << ": " << e.what() << std::endl;
+      }
+      continue;
+    }
+
+    // the packet of this frame, rather than the last one sent
+    auto packet_size = gop_packet_sizes.find(frame->pts);
+    if (packet_size != gop_packet_sizes.end()) {
+      frame_info.size = packet_size->second;
+    }
+
+    const auto &fields = frame_info_fields();
+    for (size_t i = 0; i < fields.size(); i++) {
+      if (SequenceAggregator::is_aggregated(fields[i])) {
+        gop_estimator->add_value(i, fields[i].get(frame_info));
+      }
+    }
+    gop_estimator->add_frame();
+    return true;
+  }
+  return false;
+}
+
+FrameInfo VideoParser::frame_info_at(const RangePosition &position) {
+  if (options.mode != ParseMode::Full || options.sample_gops > 0) {
+    throw std::runtime_error(
+        "Frame lookups can only be used with the full parse mode");
+  }
+  if (!position.is_set()) {
+    throw std::runtime_error("Invalid frame position");
+  }
+  // the packets are no longer read in order
+  index_writer.reset();
+  if (!current_packet) {
+    current_packet = av_packet_alloc();
+    if (!current_packet) {
+      throw std::runtime_error("Error allocating packet");
+    }
+  }
+
+  for (auto gop = gop_cache.begin(); gop != gop_cache.end(); ++gop) {
+    if (const FrameInfo *cached = find_cached_frame(*gop, position)) {
+      FrameInfo frame_info = *cached;
+      if (gop != gop_cache.begin()) {
+        // only the most recent GOP is continued
+        is_gop_open = false;
+        gop_cache.splice(gop_cache.begin(), gop_cache, gop);
+      }
+      return frame_info;
+    }
+  }
+
+  // a later frame of the GOP that is being decoded
+  if (is_gop_open && !gop_cache.front().frames.empty()) {
+    const FrameInfo &last = gop_cache.front().frames.back();
+    if (position.is_frame ? position.value > last.frame_idx
+                          : position.value >= last.pts) {
+      if (const FrameInfo *decoded = decode_cached_gop(position)) {
+        return *decoded;
+      }
+    }
+  }
+
+  int64_t timestamp = position_timestamp(position);
+  for (int attempt = 0; attempt < 2; attempt++) {
+    seek_to_key_frame(timestamp);
+    avcodec_flush_buffers(codec_context);
+    is_seek_pending = true;
+    gop_cache.emplace_front();
+    is_gop_open = true;
+    while (gop_cache.size() >
+           std::max<uint32_t>(1, options.frame_cache_gops)) {
+      gop_cache.pop_back();
+    }
+    if (const FrameInfo *decoded = decode_cached_gop(position)) {
+      return *decoded;
+    }
+
+    // with reordering delay, a key frame may be presented after the position
+    // although it is decoded before it; the frame is then in the previous GOP
+    const CachedGop &gop = gop_cache.front();
+    if (gop.frames.empty() || gop.frames.front().frame_idx == 0 ||
+        gop.key_dts == AV_NOPTS_VALUE ||
+        (position.is_frame ? position.value >= gop.frames.front().frame_idx
+                           : position.value >= gop.frames.front().pts)) {
+      break;
+    }
+    timestamp = gop.key_dts - 1;
+  }
+  throw std::runtime_error("No frame found at the position");
+}
+
+/**
+ * @brief Find the frame at a position among the decoded frames of a GOP
+ *
+ * For a time, the frame presented at that time is only known once the next
+ * frame is decoded, unless the time is exactly its timestamp, or once the GOP
+ * is complete.
+ *
+ * @param gop The GOP
+ * @param position The position
+ * @return const FrameInfo* The frame, or nullptr if it was not decoded
+ */
+const FrameInfo *
+VideoParser::find_cached_frame(const CachedGop &gop,
+                               const RangePosition &position) const {
+  const std::vector<FrameInfo> &frames = gop.frames;
+  for (size_t i = 0; i < frames.size(); i++) {
+    if (position.is_frame) {
+      if (frames[i].frame_idx == position.value) {
+        return &frames[i];
+      }
+    } else if (frames[i].pts == position.value) {
+      return &frames[i];
+    } else if (frames[i].pts > position.value) {
+      return i > 0 ? &frames[i - 1] : nullptr;
+    }
+  }
+  // the last frame is presented until the next key frame
+  if (!position.is_frame && gop.is_complete && !frames.empty() &&
+      frames.front().pts <= position.value && position.value < gop.end_pts) {
+    return &frames.back();
+  }
+  return nullptr;
+}
+
+/**
+ * @brief Continue decoding the most recent GOP of the cache until the frame
+ * at a position is found
+ *
+ * The GOP ends at the next key packet, and the decoder is then drained.
+ *
+ * @param position The position
+ * @return const FrameInfo* The frame, or nullptr if it is not in the GOP
+ */
+const FrameInfo *VideoParser::decode_cached_gop(const RangePosition &position) {
+  CachedGop &gop = gop_cache.front();
+  for (;;) {
+    while (avcodec_receive_frame(codec_context, frame) == 0) {
+      FrameInfo frame_info;
+      try {
+        set_frame_info(frame_info);
+      } catch (const std::exception &e) {
+        if (verbose) {
+          std::cerr << "Warning: Could not set frame info for frame index "
+                    << frame_idx << ": " << e.what() << std::endl;
+        }
+        continue;
+      }
+      // the packet of this frame, rather than the last one sent
+      auto packet_size = gop.packet_sizes.find(frame->pts);
+      if (packet_size != gop.packet_sizes.end()) {
+        frame_info.size = packet_size->second;
+      }
+      gop.frames.push_back(frame_info);
+      if (const FrameInfo *found = find_cached_frame(gop, position)) {
+        return found;
+      }
+    }
+
+    if (!is_gop_open) {
+      // drained
+      gop.is_complete = true;
+      gop.packet_sizes.clear();
+      return find_cached_frame(gop, position);
+    }
+
+    av_packet_unref(current_packet);
+    if (av_read_frame(format_context, current_packet) < 0) {
+      avcodec_send_packet(codec_context, nullptr);
+      is_gop_open = false;
+      continue;
+    }
+    if (current_packet->stream_index != video_stream_idx) {
+      continue;
+    }
+    on_video_packet();
+    if (gop.packet_count > 0 && (current_packet->flags & AV_PKT_FLAG_KEY)) {
+      if (current_packet->pts != AV_NOPTS_VALUE) {
+        gop.end_pts = current_packet->pts * av_q2d(get_time_base());
+      }
+      avcodec_send_packet(codec_context, nullptr);
+      is_gop_open = false;
+      continue;
+    }
+    if (gop.packet_count == 0) {
+      gop.key_dts = current_packet->dts;
+    }
+    gop.packet_count++;
+    gop.packet_sizes[current_packet->pts] = current_packet->size;
+    avcodec_send_packet(codec_context, current_packet);
+  }
+}
+
 /**
  * @brief Close the input and free memory
  */
 void VideoParser::close() {
   av_packet_free(&current_packet);
   av_frame_free(&frame);
+  if (parser) {
+    av_parser_close(parser);
+    parser = nullptr;
+  }
+  videoparser_cbs_headers_close(&cbs_headers);
 }
 } // namespace videoparser
@@ -8,14 +8,19 @@
 #ifndef VIDEOPARSER_H
 #define VIDEOPARSER_H
 
+#include <cmath>
 #include <cstdlib>
 #include <filesystem>
 #include <fstream>
 #include <functional>
 #include <iomanip> // for std::fixed and std::setprecision
 #include <iostream>
+#include <list>
+#include <map>
 #include <optional>
+#include <set>
 #include <string>
+#include <vector>
 extern "C" {
 #include "include/shared.h"
 #include <libavcodec/avcodec.h>
@@ -26,6 +31,24 @@ extern "C" {
 #include <unistd.h>
 }
 
+#include "CbsHeaders.h"
+#include "GopSampling.h"
+#include "Mp4SampleTable.h"
+#include "PacketIndex.h"
+#include "TemporalLayers.h"
+
+/**
+ * @brief Metric groups of the FrameInfo fields, used to select the fields to
+ * output.
+ */
+#define VIDEOPARSER_METRIC_QP (1 << 0) /**< qp_* */
+#define VIDEOPARSER_METRIC_MOTION                                              \
+  (1 << 1) /**< motion_*, mb_mv_count, mv_coded_count */
+#define VIDEOPARSER_METRIC_BIT_COUNT                                           \
+  (1 << 2) /**< motion_bit_count, coefs_bit_count */
+#define VIDEOPARSER_METRIC_POC (1 << 3) /**< current_poc, poc_diff */
+#define VIDEOPARSER_METRIC_ALL 0xFFFFFFFFu /**< All metrics (default) */
+
 #define VIDEOPARSER_VERSION_MAJOR 0
 #define VIDEOPARSER_VERSION_MINOR 5
 #define VIDEOPARSER_VERSION_PATCH 5
@@ -54,6 +77,14 @@ struct SequenceInfo {
   int video_bit_depth = 0;      /**< Bit depth of the video stream */
   char video_pix_fmt[32];       /**< Pixel format of the video stream */
   uint32_t video_frame_count;   /**< Number of frames in the video stream */
+  uint32_t gop_count = 0; /**< With ParserOptions::sample_gops, the number of
+                             GOPs in the container index, or 0 if unknown */
+  uint32_t sampled_gop_count = 0; /**< With ParserOptions::sample_gops, the
+                                     number of GOPs decoded so far */
+  /** With ParserOptions::sample_gops, the estimated mean of each field over
+   * all frames, indexed like frame_info_fields(); only set for the fields
+   * that SequenceAggregator aggregates */
+  std::vector<MetricEstimate> estimates;
 };
 
 enum FrameType {
@@ -112,6 +143,167 @@ struct FrameInfo {
   // double mv_diff_sum_sqr; /**< Sum of squared MV differences */
 };
 
+/**
+ * @brief Describes one numeric field of FrameInfo.
+ *
+ * This allows writing generic code (serialization, statistics) over all frame
+ * metrics without listing every field again. All values are passed as double,
+ * which represents every integer field exactly.
+ */
+struct FrameInfoField {
+  const char *name; /**< Field name, as used in the JSON output */
+  bool is_integer;  /**< Whether the field holds integer values */
+  uint32_t metric;  /**< VIDEOPARSER_METRIC_* group of the field, or 0 for
+                       frame metadata that is always available */
+  double (*get)(const FrameInfo &frame_info); /**< Read the field */
+  void (*set)(FrameInfo &frame_info, double value); /**< Write the field */
+};
+
+/**
+ * @brief Get the list of all numeric FrameInfo fields, in output order
+ *
+ * @return const std::vector<FrameInfoField>& The field descriptors
+ */
+const std::vector<FrameInfoField> &frame_info_fields();
+
+/**
+ * @brief A selection of metrics to output.
+ */
+struct MetricSelection {
+  uint32_t metrics_mask = 0; /**< VIDEOPARSER_METRIC_* groups of the fields */
+  std::vector<const FrameInfoField *> fields; /**< Fields to output */
+};
+
+/**
+ * @brief Parse a comma-separated list of metrics
+ *
+ * Each entry is either a FrameInfo field name (e.g. `size`, `qp_avg`) or one
+ * of the metric groups `qp`, `motion`, `bits` and `poc`, which select all
+ * fields of that group.
+ *
+ * @param list The list, e.g. "qp,size,frame_type"
+ * @return MetricSelection The selected fields and the groups they require
+ * @throws std::runtime_error If an entry is unknown
+ */
+MetricSelection select_metrics(const std::string &list);
+
+/**
+ * @brief Select all fields of the given metric groups
+ *
+ * @param metrics_mask VIDEOPARSER_METRIC_* groups
+ * @return MetricSelection The frame metadata fields and all fields of the
+ * groups
+ */
+MetricSelection select_metrics(uint32_t metrics_mask);
+
+/**
+ * @brief How much of the bitstream the parser reads.
+ */
+enum class ParseMode {
+  Full,    /**< Decode all frames and compute all selected metrics */
+  Headers, /**< Only read the slice, frame and OBU headers, without decoding:
+              frame metadata, qp_init and the POC (H.264/HEVC) */
+  Packets, /**< Only read packets from the demuxer: frame_idx, dts, pts, size
+              and is_idr (from the key frame flag of the container) */
+};
+
+/**
+ * @brief Get a parse mode by name
+ *
+ * @param name One of `full`, `headers` and `packets`
+ * @return ParseMode The parse mode
+ * @throws std::runtime_error If the name is unknown
+ */
+ParseMode parse_mode_from_name(const std::string &name);
+
+/**
+ * @brief Whether a parse mode computes a field
+ *
+ * @param field The field
+ * @param mode The parse mode
+ * @return true If the field is computed in this mode, false if it is always
+ * zero
+ */
+bool is_available(const FrameInfoField &field, ParseMode mode);
+
+/**
+ * @brief Remove the fields that a parse mode does not compute from a selection
+ *
+ * @param selection The selection
+ * @param mode The parse mode
+ * @return MetricSelection The fields of the selection that are available
+ */
+MetricSelection restrict_metrics(const MetricSelection &selection,
+                                 ParseMode mode);
+
+/**
+ * @brief A start or end position of the parsed range.
+ */
+struct RangePosition {
+  double value = -1;     /**< Position in seconds or frames, negative if not
+                            set */
+  bool is_frame = false; /**< Whether the value is a zero-based frame index
+                            rather than a presentation timestamp in seconds */
+
+  bool is_set() const { return value >= 0; } /**< Whether it is set */
+};
+
+/**
+ * @brief Parse a range position
+ *
+ * @param text Seconds, e.g. `90.5`, or a frame index with an `f` suffix, e.g.
+ * `2250f`
+ * @return RangePosition The position
+ * @throws std::runtime_error If the text is not a valid position
+ */
+RangePosition range_position_from_string(const std::string &text);
+
+/**
+ * @brief Options that control what the parser computes.
+ */
+struct ParserOptions {
+  uint32_t metrics = VIDEOPARSER_METRIC_ALL; /**< VIDEOPARSER_METRIC_* groups
+                                                to return; the fields of all
+                                                others are zero */
+  ParseMode mode = ParseMode::Full; /**< How much of the bitstream to read;
+                                       fields that the mode does not compute
+                                       are zero */
+  bool keyframes_only = false; /**< Only decode and return key frames; the
+                                  sizes of all other packets still count
+                                  towards the bitrate */
+  int max_temporal_id = -1; /**< Only decode and return HEVC and AV1 pictures
+                               up to this temporal ID, or -1 for all layers;
+                               the sizes of all other packets still count
+                               towards the bitrate */
+  uint32_t sample_gops = 0; /**< Only decode this many GOPs, starting at key
+                               frames spread over the file, and estimate the
+                               means over all frames from them (see
+                               SequenceInfo::estimates), or 0 to decode all
+                               frames. Requires ParseMode::Full */
+  SampleMethod sample_method =
+      SampleMethod::Stratified; /**< How the sampled GOPs are chosen */
+  uint64_t sample_seed = 0;     /**< Seed for choosing the sampled GOPs */
+  RangePosition start; /**< Only return frames from this position on; parsing
+                          seeks to the preceding key frame, and the frames up
+                          to the position are decoded but not returned */
+  RangePosition end;   /**< Stop before the first frame at or after this
+                          position. With a range, get_sequence_info() reports
+                          the duration, frame count and bitrate of the
+                          returned frames */
+  bool use_index = true;    /**< Use the sidecar index of the file (see
+                               PacketIndex) for seeking and frame indices, if
+                               it exists and matches the file */
+  bool write_index = false; /**< Write the sidecar index of the file once all
+                               of its packets were read */
+  uint32_t frame_cache_gops = 4; /**< Number of decoded GOPs whose frames
+                                    VideoParser::frame_info_at() keeps, at
+                                    least one */
+  bool use_sample_table = true; /**< With ParseMode::Packets, read the packets
+                                   of MP4/MOV files from their sample tables
+                                   (see Mp4SampleTable) instead of the
+                                   demuxer, without reading the media data */
+};
+
 /**
  * @brief Set verbose mode for the parser
  *
@@ -142,10 +334,12 @@ public:
    * found.
    *
    * @param filename C-style string path to the video file to parse
+   * @param options Options that control what the parser computes
    * @throws std::runtime_error If the file cannot be opened or no video stream
    * is found
    */
-  VideoParser(const char *filename);
+  VideoParser(const char *filename,
+              const ParserOptions &options = ParserOptions());
 
   /**
    * @brief Get information about the video sequence
@@ -157,12 +351,23 @@ public:
    */
   SequenceInfo get_sequence_info();
 
+  /**
+   * @brief Get the time base of the video stream
+   *
+   * All timestamps in FrameInfo are integer multiples of this time base,
+   * converted to seconds.
+   *
+   * @return AVRational The time base
+   */
+  AVRational get_time_base() const;
+
   /**
    * @brief Parse the next frame in the video
    *
    * This method should be called in a loop to parse all frames in the video.
    * It will fill the provided frame_info struct with information about the
-   * parsed frame.
+   * parsed frame. With ParseMode::Full, frames are returned in presentation
+   * order, in all other modes in decoding order.
    *
    * @param frame_info Reference to a FrameInfo struct to be filled with frame
    * information
@@ -171,6 +376,24 @@ public:
    */
   bool parse_frame(FrameInfo &frame_info);
 
+  /**
+   * @brief Get the information of a single frame, without parsing the frames
+   * before it
+   *
+   * Seeks to the key frame at or before the position and decodes up to the
+   * frame. The frames of the most recently used GOPs are kept (see
+   * ParserOptions::frame_cache_gops), so that nearby frames are returned
+   * without decoding again, and a later frame of the GOP decoded last
+   * continues where decoding stopped. Requires ParseMode::Full. Calling
+   * parse_frame() afterwards continues from the position of the last lookup.
+   *
+   * @param position A frame index, or a time in seconds for the frame that is
+   * presented at that time
+   * @return FrameInfo The frame information
+   * @throws std::runtime_error If there is no frame at the position
+   */
+  FrameInfo frame_info_at(const RangePosition &position);
+
   /**
    * @brief Close the video file and free resources
    *
@@ -180,6 +403,7 @@ public:
   void close();
 
 private:
+  ParserOptions options;
   int video_stream_idx = -1;
   AVFormatContext *format_context = nullptr;
   AVCodecContext *codec_context = nullptr;
@@ -193,8 +417,82 @@ private:
                                 // available from format context
   std::function<void()> close_input;
 
+  // ParserOptions::keyframes_only and max_temporal_id
+  std::optional<TemporalLayers> temporal_layers;
+  std::multiset<double> skipped_pts; // not yet counted in frame_idx
+
+  // ParserOptions::sample_gops
+  std::vector<int64_t> sampled_gops; // seek targets, in the stream time base
+  size_t sampled_gop_idx = 0;
+  bool gop_started = false;  // seeked to sampled_gops[sampled_gop_idx]
+  bool gop_draining = false; // all packets of the GOP sent
+  int64_t gop_key_dts = INT64_MIN;
+  int64_t gop_first_frame_idx = 0;
+  uint32_t gop_frame_count = 0;
+  std::map<int64_t, int> gop_packet_sizes; // by pts
+  uint64_t index_size_sum = 0;             // 0 without index
+  std::optional<GopSampleEstimator> gop_estimator;
+
+  // ParserOptions::start and end
+  bool is_seek_pending = false; // frame_idx is set from the next packet
+  bool is_range_done = false;
+  uint32_t range_frame_count = 0;
+  uint64_t range_size_sum = 0;
+  double range_first_pts = 0;
+  double range_last_pts = 0;
+
+  // ParserOptions::use_index and write_index
+  std::string file_path;
+  std::string index_path;
+  std::optional<PacketIndex> packet_index; // loaded
+  std::optional<PacketIndex> index_writer;
+
+  // frame_info_at()
+  struct CachedGop {
+    std::vector<FrameInfo> frames;       // in presentation order
+    std::map<int64_t, int> packet_sizes; // by pts, while decoding
+    uint32_t packet_count = 0;
+    int64_t key_dts = AV_NOPTS_VALUE;
+    double end_pts = INFINITY; // of the next key frame
+    bool is_complete = false;
+  };
+  std::list<CachedGop> gop_cache; // most recently used first
+  bool is_gop_open = false;       // gop_cache.front() is being decoded
+
+  // ParserOptions::use_sample_table
+  std::optional<Mp4SampleTable> sample_table;
+  size_t sample_idx = 0; // next sample to read
+
+  // ParseMode::Headers
+  AVCodecParserContext *parser = nullptr;
+  VideoParserCbsHeaders *cbs_headers = nullptr;
+  int last_poc = 0;
+
   void print_shared_frame_info(SharedFrameInfo &shared_frame_info);
   void set_frame_info(FrameInfo &frame_info);
+  bool parse_packet(FrameInfo &frame_info);
+  void load_sample_table(const char *filename);
+  bool read_packet();
+  bool is_full_index() const;
+  int64_t packet_frame_idx();
+  void load_packet_index();
+  void on_video_packet();
+  void write_packet_index();
+  void seek_to_key_frame(int64_t timestamp);
+  int64_t position_timestamp(const RangePosition &position);
+  void seek_to_range_start();
+  bool is_before_range(int64_t idx, double time) const;
+  bool is_after_range(int64_t idx, double time) const;
+  void add_range_frame(const FrameInfo &frame_info);
+  void init_gop_sampling();
+  bool parse_sampled_frame(FrameInfo &frame_info);
+  bool receive_sampled_frame(FrameInfo &frame_info);
+  const FrameInfo *find_cached_frame(const CachedGop &gop,
+                                     const RangePosition &position) const;
+  const FrameInfo *decode_cached_gop(const RangePosition &position);
+  bool skip_packet();
+  void set_frame_info_from_packet(FrameInfo &frame_info);
+  void set_frame_info_from_headers(FrameInfo &frame_info);
   void set_frame_info_h264(FrameInfo &frame_info);
   void set_frame_info_h265(FrameInfo &frame_info);
   void set_frame_info_vp9(FrameInfo &frame_info);
@@ -0,0 +1,223 @@
+/**
+ * @file Windowing.cpp
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#include "Windowing.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace videoparser {
+
+// running sums accumulate rounding errors from removing values, so they are
+// recomputed from the buffer after this many removals
+static const uint64_t RECOMPUTE_INTERVAL = 4096;
+
+SlidingWindow::SlidingWindow(double length, double step, Callback callback)
+    : length(length), step(step), callback(std::move(callback)) {
+  if (!(length > 0) || !(step > 0)) {
+    throw std::runtime_error("Window length and step must be positive");
+  }
+
+  const auto &fields = frame_info_fields();
+  for (size_t i = 0; i < fields.size(); i++) {
+    if (SequenceAggregator::is_aggregated(fields[i])) {
+      field_indices.push_back(i);
+    }
+  }
+  offset.resize(field_indices.size());
+  sum.resize(field_indices.size());
+  sum_sq.resize(field_indices.size());
+  frames.resize(64);
+}
+
+double SlidingWindow::frame_time(const FrameInfo &frame_info) {
+  return std::isfinite(frame_info.dts) ? frame_info.dts : frame_info.pts;
+}
+
+const FrameInfo &SlidingWindow::at(size_t i) const {
+  return frames[(head + i) % frames.size()];
+}
+
+void SlidingWindow::push(const FrameInfo &frame_info) {
+  if (count == frames.size()) {
+    // grow the ring buffer, unrolling it to start at index 0
+    std::vector<FrameInfo> grown(frames.size() * 2);
+    for (size_t i = 0; i < count; i++) {
+      grown[i] = at(i);
+    }
+    frames = std::move(grown);
+    head = 0;
+  }
+  frames[(head + count) % frames.size()] = frame_info;
+  count++;
+
+  const auto &fields = frame_info_fields();
+  for (size_t i = 0; i < field_indices.size(); i++) {
+    double value = fields[field_indices[i]].get(frame_info) - offset[i];
+    sum[i] += value;
+    sum_sq[i] += value * value;
+  }
+  size_sum += frame_info.size;
+}
+
+void SlidingWindow::pop() {
+  const FrameInfo &frame_info = at(0);
+  const auto &fields = frame_info_fields();
+  for (size_t i = 0; i < field_indices.size(); i++) {
+    double value = fields[field_indices[i]].get(frame_info) - offset[i];
+    sum[i] -= value;
+    sum_sq[i] -= value * value;
+  }
+  size_sum -= frame_info.size;
+  head = (head + 1) % frames.size();
+  count--;
+
+  if (++removals % RECOMPUTE_INTERVAL == 0) {
+    recompute_sums();
+  }
+}
+
+void SlidingWindow::recompute_sums() {
+  const auto &fields = frame_info_fields();
+  std::fill(sum.begin(), sum.end(), 0.0);
+  std::fill(sum_sq.begin(), sum_sq.end(), 0.0);
+  size_sum = 0;
+  for (size_t j = 0; j < count; j++) {
+    const FrameInfo &frame_info = at(j);
+    for (size_t i = 0; i < field_indices.size(); i++) {
+      double value = fields[field_indices[i]].get(frame_info) - offset[i];
+      sum[i] += value;
+      sum_sq[i] += value * value;
+    }
+    size_sum += frame_info.size;
+  }
+}
+
+void SlidingWindow::add_frame(const FrameInfo &frame_info) {
+  double time = frame_time(frame_info);
+  if (!started) {
+    started = true;
+    first_dts = time;
+    window_end = time + length;
+    const auto &fields = frame_info_fields();
+    for (size_t i = 0; i < field_indices.size(); i++) {
+      offset[i] = fields[field_indices[i]].get(frame_info);
+    }
+  }
+
+  // emit all windows that end before this frame
+  while (time >= window_end) {
+    while (count > 0 && frame_time(at(0)) < window_end - length) {
+      pop();
+    }
+    if (count == 0) {
+      // skip empty windows, e.g. after a gap in the timestamps
+      window_end += (std::floor((time - window_end) / step) + 1) * step;
+      break;
+    }
+    emit(window_end - length, window_end, length);
+    window_end += step;
+  }
+
+  push(frame_info);
+  last_dts = time;
+  pending = true;
+}
+
+void SlidingWindow::flush() {
+  if (!pending) {
+    return;
+  }
+  while (count > 0 && frame_time(at(0)) < window_end - length) {
+    pop();
+  }
+  if (count == 0) {
+    return;
+  }
+
+  // the last frame lasts for one average frame interval
+  double interval =
+      count > 1 ? (last_dts - frame_time(at(0))) / (count - 1) : 0.0;
+  double start = std::max(window_end - length, first_dts);
+  double end = std::min(window_end, last_dts + interval);
+  emit(start, end, end - start);
+}
+
+void SlidingWindow::emit(double start, double end, double duration) {
+  WindowInfo window;
+  window.length = length;
+  window.start = start;
+  window.end = end;
+  window.duration = duration;
+  window.frame_count = count;
+  window.bitrate = duration > 0 ? size_sum * 8 / 1000 / duration : 0.0;
+  window.framerate = duration > 0 ? count / duration : 0.0;
+
+  const auto &fields = frame_info_fields();
+  window.mean.assign(fields.size(), 0.0);
+  window.stdev.assign(fields.size(), 0.0);
+  for (size_t i = 0; i < field_indices.size(); i++) {
+    double mean = sum[i] / count;
+    double variance = std::max(sum_sq[i] / count - mean * mean, 0.0);
+    window.mean[field_indices[i]] = offset[i] + mean;
+    window.stdev[field_indices[i]] = std::sqrt(variance);
+  }
+
+  pending = false;
+  callback(window);
+}
+
+GopAggregator::GopAggregator(Callback callback)
+    : callback(std::move(callback)) {
+  current.frames.fields.resize(frame_info_fields().size());
+}
+
+void GopAggregator::add_frame(const FrameInfo &frame_info) {
+  double time = std::isfinite(frame_info.dts) ? frame_info.dts : frame_info.pts;
+  if (frame_info.is_idr && current.frames.frame_count > 0) {
+    emit(time);
+  }
+  if (current.frames.frame_count == 0) {
+    current.start = time;
+  }
+
+  const auto &fields = frame_info_fields();
+  for (size_t i = 0; i < fields.size(); i++) {
+    if (SequenceAggregator::is_aggregated(fields[i])) {
+      current.frames.fields[i].add(fields[i].get(frame_info));
+    }
+  }
+  current.frames.frame_count++;
+  size_sum += frame_info.size;
+  last_dts = time;
+}
+
+void GopAggregator::flush() {
+  uint64_t n = current.frames.frame_count;
+  if (n == 0) {
+    return;
+  }
+  // the last frame lasts for one average frame interval
+  double interval = n > 1 ? (last_dts - current.start) / (n - 1) : 0.0;
+  emit(last_dts + interval);
+}
+
+void GopAggregator::emit(double end) {
+  current.gop_idx = gop_idx++;
+  current.end = end;
+  double duration = end - current.start;
+  current.bitrate = duration > 0 ? size_sum * 8 / 1000 / duration : 0.0;
+  callback(current);
+
+  current.frames.frame_count = 0;
+  std::fill(current.frames.fields.begin(), current.frames.fields.end(),
+            RunningStats());
+  size_sum = 0;
+}
+
+} // namespace videoparser
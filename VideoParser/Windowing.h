@@ -0,0 +1,169 @@
+/**
+ * @file Windowing.h
+ * @author Werner Robitza
+ * @copyright Copyright (c) 2026, AVEQ GmbH. Copyright (c) 2026,
+ * videoparser-ng contributors.
+ */
+
+#ifndef VIDEOPARSER_WINDOWING_H
+#define VIDEOPARSER_WINDOWING_H
+
+#include "Statistics.h"
+#include "VideoParser.h"
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace videoparser {
+
+/**
+ * @brief Statistics over the frames in one time window.
+ */
+struct WindowInfo {
+  double length;        /**< Nominal window length in seconds */
+  double start;         /**< Start of the window in seconds (inclusive) */
+  double end;           /**< End of the window in seconds (exclusive) */
+  double duration;      /**< Duration covered by frames, at most length */
+  uint64_t frame_count; /**< Number of frames in the window */
+  double bitrate;       /**< Bitrate in kbit/s over the covered duration */
+  double framerate;     /**< Frame rate over the covered duration */
+  /** Mean of each field, indexed like frame_info_fields() */
+  std::vector<double> mean;
+  /** Population standard deviation of each field, indexed like
+   * frame_info_fields() */
+  std::vector<double> stdev;
+};
+
+/**
+ * @brief Statistics over the frames of one group of pictures.
+ */
+struct GopInfo {
+  uint64_t gop_idx;       /**< GOP number, zero-based */
+  double start;           /**< Decoding timestamp of the first frame */
+  double end;             /**< Decoding timestamp of the next GOP's first
+                             frame, or of the last frame at the end */
+  double bitrate;         /**< Bitrate in kbit/s */
+  FrameAggregates frames; /**< Statistics of all frames of the GOP */
+};
+
+/**
+ * @brief Computes rolling statistics over a sliding time window.
+ *
+ * Frames are kept in a ring buffer, ordered by decoding timestamp. For every
+ * aggregated field (see SequenceAggregator::is_aggregated()), running sums of
+ * the values and their squares are updated when a frame enters or leaves the
+ * window, so that each update is O(1) regardless of the window length.
+ *
+ * Frames are added in the order VideoParser returns them: presentation order
+ * in the full parse mode, and decoding order in the headers and packets modes.
+ * Either way, windows are placed by `dts` (or `pts` if a frame has no DTS),
+ * which does not decrease: for decoded frames, it is the DTS of the packet
+ * with which the decoder returned the frame.
+ *
+ * Windows end at `first_dts + length + k * step`. A window is emitted once the
+ * first frame after its end has been added, i.e. only complete windows are
+ * emitted while parsing; flush() emits the last, possibly partial window.
+ */
+class SlidingWindow {
+public:
+  /** Called for every completed window */
+  using Callback = std::function<void(const WindowInfo &)>;
+
+  /**
+   * @brief Construct a new sliding window
+   *
+   * @param length Window length in seconds
+   * @param step Time between the ends of two consecutive windows in seconds
+   * @param callback Called for every completed window
+   */
+  SlidingWindow(double length, double step, Callback callback);
+
+  /**
+   * @brief Add a frame, in the order returned by VideoParser::parse_frame()
+   *
+   * @param frame_info The frame to add
+   */
+  void add_frame(const FrameInfo &frame_info);
+
+  /**
+   * @brief Emit the window that contains the last frames, if it has not been
+   * emitted yet
+   */
+  void flush();
+
+private:
+  double length;
+  double step;
+  Callback callback;
+
+  // ring buffer of the frames in the current window
+  std::vector<FrameInfo> frames;
+  size_t head = 0;
+  size_t count = 0;
+
+  std::vector<size_t> field_indices; // aggregated fields
+  std::vector<double> offset;        // first value, to reduce cancellation
+  std::vector<double> sum;
+  std::vector<double> sum_sq;
+  double size_sum = 0;
+  uint64_t removals = 0;
+
+  bool started = false;
+  double first_dts = 0;
+  double window_end = 0;
+  double last_dts = 0;
+  bool pending = false; // frames added since the last emitted window
+
+  static double frame_time(const FrameInfo &frame_info);
+  const FrameInfo &at(size_t i) const;
+  void push(const FrameInfo &frame_info);
+  void pop();
+  void recompute_sums();
+  void emit(double start, double end, double duration);
+};
+
+/**
+ * @brief Computes statistics per group of pictures.
+ *
+ * Frames are added in the order VideoParser returns them, as for
+ * SlidingWindow. A new GOP starts at every key frame (`is_idr`). The
+ * statistics of a GOP are emitted when the next GOP starts, or on flush().
+ */
+class GopAggregator {
+public:
+  /** Called for every completed GOP */
+  using Callback = std::function<void(const GopInfo &)>;
+
+  /**
+   * @brief Construct a new GOP aggregator
+   *
+   * @param callback Called for every completed GOP
+   */
+  GopAggregator(Callback callback);
+
+  /**
+   * @brief Add a frame, in the order returned by VideoParser::parse_frame()
+   *
+   * @param frame_info The frame to add
+   */
+  void add_frame(const FrameInfo &frame_info);
+
+  /**
+   * @brief Emit the current GOP, if it has any frames
+   */
+  void flush();
+
+private:
+  Callback callback;
+  uint64_t gop_idx = 0;
+  double size_sum = 0;
+  double last_dts = 0;
+  GopInfo current;
+
+  void emit(double end);
+};
+
+} // namespace videoparser
+
+#endif // VIDEOPARSER_WINDOWING_H
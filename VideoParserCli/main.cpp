@@ -5,10 +5,18 @@
  * videoparser-ng contributors.
  */
 
+#include "OutputWriter.h"
+#include "P1204Features.h"
+#include "Statistics.h"
+#include "StatsArchive.h"
 #include "VideoParser.h"
+#include "Windowing.h"
 #include "json.hpp"
 #include "termcolor.hpp"
+#include <algorithm>
+#include <cstring>
 #include <cxxopts.hpp>
+#include <sstream>
 
 using json = nlohmann::json;
 
@@ -35,7 +43,10 @@ void print_sequence_info(const videoparser::SequenceInfo &info) {
   std::cerr << "Video frame count   = " << info.video_frame_count << std::endl;
 }
 
-void print_sequence_info_json(const videoparser::SequenceInfo &info) {
+// `extensions` are additional keys, e.g. aggregated frame statistics
+void print_sequence_info_json(const videoparser::SequenceInfo &info,
+                              videoparser::OutputWriter &output,
+                              const json &extensions = json::object()) {
   json j;
   j["type"] = "sequence_info";
   j["video_duration"] = info.video_duration;
@@ -49,7 +60,8 @@ void print_sequence_info_json(const videoparser::SequenceInfo &info) {
   j["video_bit_depth"] = info.video_bit_depth;
   j["video_pix_fmt"] = info.video_pix_fmt;
   j["video_frame_count"] = info.video_frame_count;
-  std::cout << j.dump() << std::endl;
+  j.update(extensions);
+  output.write(j.dump() + "\n");
 }
 
 // Note: This is not everything, see the JSON below
@@ -65,7 +77,9 @@ void print_general_frame_info(const videoparser::FrameInfo &frame_info) {
   std::cerr << "Is IDR      = " << frame_info.is_idr << std::endl;
 }
 
-void print_frame_info_json(const videoparser::FrameInfo &frame_info) {
+void print_frame_info_json(
+    const videoparser::FrameInfo &frame_info, videoparser::OutputWriter &output,
+    const videoparser::MetricSelection *selection = nullptr) {
   json j;
   j["type"] = "frame_info";
   j["frame_idx"] = frame_info.frame_idx;
@@ -108,7 +122,178 @@ void print_frame_info_json(const videoparser::FrameInfo &frame_info) {
   // j["mv_x_sum_sqr"] = frame_info.mv_x_sum_sqr;
   // j["mv_y_sum_sqr"] = frame_info.mv_y_sum_sqr;
   // j["mv_length_diff"] = frame_info.mv_length_diff;
-  std::cout << j.dump() << std::endl;
+
+  // only keep the selected metrics, plus the frame index to identify frames
+  if (selection) {
+    json selected;
+    selected["type"] = j["type"];
+    selected["frame_idx"] = j["frame_idx"];
+    for (const auto *field : selection->fields) {
+      selected[field->name] = j[field->name];
+    }
+    j = selected;
+  }
+  output.write(j.dump() + "\n");
+}
+
+// Whether a field is selected, or all fields if there is no selection
+bool is_selected(const videoparser::FrameInfoField &field,
+                 const videoparser::MetricSelection *selection) {
+  return !selection ||
+         std::find(selection->fields.begin(), selection->fields.end(),
+                   &field) != selection->fields.end();
+}
+
+json frame_aggregates_json(const videoparser::FrameAggregates &aggregates,
+                           const videoparser::MetricSelection *selection) {
+  json j;
+  j["frame_count"] = aggregates.frame_count;
+  const auto &fields = videoparser::frame_info_fields();
+  for (size_t i = 0; i < fields.size(); i++) {
+    if (!videoparser::SequenceAggregator::is_aggregated(fields[i]) ||
+        !is_selected(fields[i], selection)) {
+      continue;
+    }
+    const auto &stats = aggregates.fields[i];
+    j[fields[i].name] = {{"mean", stats.mean()},
+                         {"stdev", stats.stdev()},
+                         {"min", stats.min()},
+                         {"max", stats.max()}};
+  }
+  return j;
+}
+
+// Aggregates over all frames, and per frame type if there are any
+json aggregates_json(const videoparser::SequenceAggregator &aggregator,
+                     const videoparser::MetricSelection *selection) {
+  json j;
+  j["all"] = frame_aggregates_json(aggregator.overall(), selection);
+
+  const std::pair<videoparser::FrameType, const char *> frame_types[] = {
+      {videoparser::I, "I"},
+      {videoparser::P, "P"},
+      {videoparser::B, "B"},
+      {videoparser::UNKNOWN, "unknown"},
+  };
+  for (const auto &frame_type : frame_types) {
+    const auto &aggregates = aggregator.for_frame_type(frame_type.first);
+    if (aggregates.frame_count > 0) {
+      j[frame_type.second] = frame_aggregates_json(aggregates, selection);
+    }
+  }
+  return j;
+}
+
+// estimated means of the selected metrics, with their 95% confidence intervals
+json estimates_json(const videoparser::SequenceInfo &info,
+                    const videoparser::MetricSelection *selection) {
+  json j = json::object();
+  const auto &fields = videoparser::frame_info_fields();
+  for (size_t i = 0; i < info.estimates.size(); i++) {
+    if (!videoparser::SequenceAggregator::is_aggregated(fields[i]) ||
+        !is_selected(fields[i], selection)) {
+      continue;
+    }
+    const auto &estimate = info.estimates[i];
+    j[fields[i].name] = {{"mean", estimate.mean},
+                         {"ci_lower", estimate.ci_lower},
+                         {"ci_upper", estimate.ci_upper}};
+  }
+  return j;
+}
+
+void print_window_info_json(const videoparser::WindowInfo &window,
+                            videoparser::OutputWriter &output,
+                            const videoparser::MetricSelection *selection) {
+  json j;
+  j["type"] = "window_info";
+  j["length"] = window.length;
+  j["start"] = window.start;
+  j["end"] = window.end;
+  j["duration"] = window.duration;
+  j["frame_count"] = window.frame_count;
+  j["bitrate"] = window.bitrate;
+  j["framerate"] = window.framerate;
+  const auto &fields = videoparser::frame_info_fields();
+  for (size_t i = 0; i < fields.size(); i++) {
+    if (!videoparser::SequenceAggregator::is_aggregated(fields[i]) ||
+        !is_selected(fields[i], selection)) {
+      continue;
+    }
+    j[fields[i].name] = {{"mean", window.mean[i]}, {"stdev", window.stdev[i]}};
+  }
+  output.write(j.dump() + "\n");
+}
+
+void print_gop_info_json(const videoparser::GopInfo &gop,
+                         videoparser::OutputWriter &output,
+                         const videoparser::MetricSelection *selection) {
+  json j;
+  j["type"] = "gop_info";
+  j["gop_idx"] = gop.gop_idx;
+  j["start"] = gop.start;
+  j["end"] = gop.end;
+  j["bitrate"] = gop.bitrate;
+  j.update(frame_aggregates_json(gop.frames, selection));
+  output.write(j.dump() + "\n");
+}
+
+// Quantile sketches of a few key metrics over all frames
+struct FieldQuantiles {
+  const videoparser::FrameInfoField *field;
+  videoparser::QuantileSketch sketch;
+};
+
+std::vector<FieldQuantiles>
+quantile_fields(const videoparser::MetricSelection *selection) {
+  static const char *names[] = {"qp_avg", "motion_avg", "size"};
+  std::vector<FieldQuantiles> result;
+  for (const auto &field : videoparser::frame_info_fields()) {
+    if (std::find_if(std::begin(names), std::end(names), [&](const char *n) {
+          return strcmp(n, field.name) == 0;
+        }) == std::end(names)) {
+      continue;
+    }
+    if (!is_selected(field, selection)) {
+      continue;
+    }
+    result.push_back({&field, videoparser::QuantileSketch()});
+  }
+  return result;
+}
+
+json quantiles_json(const std::vector<FieldQuantiles> &quantiles) {
+  const std::pair<double, const char *> levels[] = {
+      {0.05, "p5"}, {0.5, "p50"}, {0.95, "p95"}, {0.99, "p99"}};
+  json j = json::object();
+  for (const auto &entry : quantiles) {
+    json field_json;
+    for (const auto &level : levels) {
+      field_json[level.second] = entry.sketch.quantile(level.first);
+    }
+    j[entry.field->name] = field_json;
+  }
+  return j;
+}
+
+json p1204_features_json(const videoparser::P1204Features &features) {
+  json j;
+  j["codec"] = features.codec;
+  for (const auto &value : features.values) {
+    j[value.first] = value.second;
+  }
+  return j;
+}
+
+// Convert an archive back to ldjson
+void read_archive(const std::string &filename,
+                  videoparser::OutputWriter &output,
+                  const videoparser::MetricSelection *selection) {
+  videoparser::ArchiveReader reader(filename);
+  print_sequence_info_json(reader.get_sequence_info(), output);
+  reader.read([&](const videoparser::FrameInfo &frame_info) {
+    print_frame_info_json(frame_info, output, selection);
+  });
 }
 
 int main(int argc, char *argv[]) {
@@ -119,6 +304,28 @@ int main(int argc, char *argv[]) {
   // clang-format off
   options.add_options()
       ("n,num-frames", "Parse only the first n frames", cxxopts::value<int>()->default_value("-1"))
+      ("o,output", "Write output to file instead of STDOUT (gzip-compressed if it ends in .gz)", cxxopts::value<std::string>()->default_value("-"))
+      ("f,format", "Output format: ldjson or archive (compressed, block-indexed binary)", cxxopts::value<std::string>()->default_value("ldjson"))
+      ("read-archive", "Treat the input file as an archive and print it as ldjson")
+      ("aggregate", "Instead of per-frame records, print one sequence_info record with statistics over all frames and per frame type")
+      ("p1204-features", "Instead of per-frame records, print one sequence_info record with the ITU-T P.1204.3 model input features")
+      ("quantiles", "Instead of per-frame records, print one sequence_info record with the p5/p50/p95/p99 of qp_avg, motion_avg and size")
+      ("window", "Also print window_info records with rolling statistics over windows of these comma-separated lengths in seconds", cxxopts::value<std::string>())
+      ("window-step", "Time between two window_info records in seconds", cxxopts::value<double>()->default_value("1"))
+      ("gop-stats", "Also print a gop_info record with statistics for each GOP")
+      ("mode", "Parse mode: full (decode all frames), headers (only frame metadata, qp_init and POC, without decoding) or packets (only packet sizes, timestamps and key frame flags)", cxxopts::value<std::string>()->default_value("full"))
+      ("keyframes-only", "Only decode and print key frames; all packets still count towards the bitrate")
+      ("max-temporal-id", "Only decode and print HEVC and AV1 pictures up to this temporal layer, -1 for all; all packets still count towards the bitrate", cxxopts::value<int>()->default_value("-1"))
+      ("start", "Only print frames from this position on: seconds, or a frame index with an f suffix (e.g. 2250f); decoding starts at the preceding key frame", cxxopts::value<std::string>())
+      ("end", "Stop before this position: seconds, or a frame index with an f suffix", cxxopts::value<std::string>())
+      ("sample-gops", "Only decode this many GOPs spread over the file, and print a final sequence_info record with the estimated means of all metrics and their 95% confidence intervals", cxxopts::value<int>()->default_value("0"))
+      ("sample-method", "How the sampled GOPs are chosen: stratified (one in each of equal parts of the file) or random", cxxopts::value<std::string>()->default_value("stratified"))
+      ("sample-seed", "Seed for choosing the sampled GOPs", cxxopts::value<uint64_t>()->default_value("0"))
+      ("write-index", "Write a sidecar index of all packets to <filename>.vpidx once the whole file was read; later runs on the same file use it to seek for --start and --sample-gops and to count frames")
+      ("no-index", "Do not use the sidecar index <filename>.vpidx")
+      ("no-sample-table", "In packets mode, read all packets of MP4/MOV files from the demuxer instead of only their sample tables")
+      ("frame-at", "Only print the frames at these comma-separated positions: seconds (the frame presented at that time), or frame indices with an f suffix; each is decoded from the preceding key frame, and recently decoded GOPs are reused", cxxopts::value<std::string>())
+      ("metrics", "Only compute and output these comma-separated metrics: field names, or the groups qp, motion, bits, poc", cxxopts::value<std::string>())
       ("v,verbose", "Show verbose output")
       ("h,help", "Show this help message")
       ("version", "Show version information")
@@ -162,6 +369,12 @@ int main(int argc, char *argv[]) {
 
   std::string filename = result["filename"].as<std::string>();
   int num_frames = result["num-frames"].as<int>();
+  std::string output_path = result["output"].as<std::string>();
+  std::string format = result["format"].as<std::string>();
+  if (format != "ldjson" && format != "archive") {
+    std::cerr << "Error: Unknown output format '" << format << "'" << std::endl;
+    return EXIT_FAILURE;
+  }
 
   // check if file exists
   if (!std::filesystem::exists(filename)) {
@@ -169,15 +382,175 @@ int main(int argc, char *argv[]) {
     return EXIT_FAILURE;
   }
 
+  bool aggregate = result.count("aggregate") > 0;
+  bool quantiles = result.count("quantiles") > 0;
+  bool p1204_features = result.count("p1204-features") > 0;
+  // summaries replace the per-frame records
+  bool summary = aggregate || quantiles || p1204_features;
+  if (summary && format == "archive") {
+    std::cerr << "Error: --aggregate, --quantiles and --p1204-features cannot "
+                 "be used with the archive format"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::vector<double> window_lengths;
+  if (result.count("window")) {
+    std::stringstream lengths(result["window"].as<std::string>());
+    std::string length;
+    while (std::getline(lengths, length, ',')) {
+      try {
+        window_lengths.push_back(std::stod(length));
+      } catch (const std::exception &) {
+        std::cerr << "Error: Invalid window length '" << length << "'"
+                  << std::endl;
+        return EXIT_FAILURE;
+      }
+    }
+  }
+  double window_step = result["window-step"].as<double>();
+  bool gop_stats = result.count("gop-stats") > 0;
+  if ((!window_lengths.empty() || gop_stats) && format == "archive") {
+    std::cerr << "Error: --window and --gop-stats cannot be used with the "
+                 "archive format"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  int sample_gops = result["sample-gops"].as<int>();
+  if (sample_gops < 0) {
+    std::cerr << "Error: Invalid number of sampled GOPs" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (sample_gops > 0 && format == "archive") {
+    std::cerr << "Error: --sample-gops cannot be used with the archive format"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (result.count("frame-at") &&
+      (format == "archive" || summary || !window_lengths.empty() ||
+       gop_stats)) {
+    std::cerr << "Error: --frame-at can only be used with per-frame ldjson "
+                 "records"
+              << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  videoparser::ParserOptions parser_options;
+  parser_options.sample_gops = sample_gops;
+  parser_options.sample_seed = result["sample-seed"].as<uint64_t>();
+  parser_options.keyframes_only = result.count("keyframes-only") > 0;
+  parser_options.max_temporal_id = result["max-temporal-id"].as<int>();
+  parser_options.write_index = result.count("write-index") > 0;
+  parser_options.use_index = result.count("no-index") == 0;
+  parser_options.use_sample_table = result.count("no-sample-table") == 0;
+  std::vector<videoparser::RangePosition> frame_positions;
+  try {
+    parser_options.mode =
+        videoparser::parse_mode_from_name(result["mode"].as<std::string>());
+    parser_options.sample_method = videoparser::sample_method_from_name(
+        result["sample-method"].as<std::string>());
+    if (result.count("start")) {
+      parser_options.start = videoparser::range_position_from_string(
+          result["start"].as<std::string>());
+    }
+    if (result.count("end")) {
+      parser_options.end = videoparser::range_position_from_string(
+          result["end"].as<std::string>());
+    }
+    if (result.count("frame-at")) {
+      std::stringstream positions(result["frame-at"].as<std::string>());
+      std::string position;
+      while (std::getline(positions, position, ',')) {
+        frame_positions.push_back(
+            videoparser::range_position_from_string(position));
+      }
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "Error: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  // without --metrics, output all fields of the computed metric groups
+  videoparser::MetricSelection metric_selection =
+      videoparser::select_metrics(parser_options.metrics);
+  if (result.count("metrics")) {
+    try {
+      metric_selection =
+          videoparser::select_metrics(result["metrics"].as<std::string>());
+    } catch (const std::exception &e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+    parser_options.metrics = metric_selection.metrics_mask;
+  }
+  // fields that the parse mode does not compute are not printed
+  metric_selection =
+      videoparser::restrict_metrics(metric_selection, parser_options.mode);
+
+  if (result.count("read-archive")) {
+    try {
+      auto output = videoparser::OutputWriter::open(output_path);
+      read_archive(filename, *output, &metric_selection);
+      output->close();
+    } catch (const std::exception &e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+  }
+
   try {
-    videoparser::VideoParser parser(filename.c_str());
+    videoparser::VideoParser parser(filename.c_str(), parser_options);
+    auto output = videoparser::OutputWriter::open(output_path);
     videoparser::SequenceInfo sequence_info;
     videoparser::FrameInfo frame_info;
 
+    // the archive stores the final sequence info at the end instead
+    std::unique_ptr<videoparser::ArchiveWriter> archive;
+    if (format == "archive") {
+      archive = std::make_unique<videoparser::ArchiveWriter>(
+          *output, parser.get_time_base());
+    }
+
+    // in summary mode, the sequence info is printed after parsing
+    videoparser::SequenceAggregator aggregator;
+    std::vector<FieldQuantiles> field_quantiles;
+    if (quantiles)
+      field_quantiles = quantile_fields(&metric_selection);
+
+    std::optional<videoparser::P1204FeatureExtractor> feature_extractor;
+    if (p1204_features)
+      feature_extractor.emplace();
+
+    // window and GOP records are printed as soon as they are complete
+    std::vector<videoparser::SlidingWindow> windows;
+    for (double length : window_lengths) {
+      windows.emplace_back(
+          length, window_step, [&](const videoparser::WindowInfo &window) {
+            print_window_info_json(window, *output, &metric_selection);
+          });
+    }
+    std::optional<videoparser::GopAggregator> gop_aggregator;
+    if (gop_stats) {
+      gop_aggregator.emplace([&](const videoparser::GopInfo &gop) {
+        print_gop_info_json(gop, *output, &metric_selection);
+      });
+    }
+
     sequence_info = parser.get_sequence_info();
     if (verbose)
       print_sequence_info(sequence_info);
-    print_sequence_info_json(sequence_info);
+    if (!archive && !summary)
+      print_sequence_info_json(sequence_info, *output);
+
+    if (!frame_positions.empty()) {
+      for (const auto &position : frame_positions)
+        print_frame_info_json(parser.frame_info_at(position), *output,
+                              &metric_selection);
+      parser.close();
+      output->close();
+      return EXIT_SUCCESS;
+    }
 
     if (verbose)
       std::cerr << "Parsing frames ..." << std::endl;
@@ -193,12 +566,57 @@ int main(int argc, char *argv[]) {
 
       if (verbose)
         print_general_frame_info(frame_info);
-      print_frame_info_json(frame_info);
+      if (aggregate)
+        aggregator.add_frame(frame_info);
+      for (auto &entry : field_quantiles)
+        entry.sketch.add(entry.field->get(frame_info));
+      for (auto &window : windows)
+        window.add_frame(frame_info);
+      if (gop_aggregator)
+        gop_aggregator->add_frame(frame_info);
+      if (feature_extractor)
+        feature_extractor->add_frame(frame_info);
+      if (archive)
+        archive->add_frame(frame_info);
+      else if (!summary)
+        print_frame_info_json(frame_info, *output, &metric_selection);
 
       frames_processed++;
     }
 
+    for (auto &window : windows)
+      window.flush();
+    if (gop_aggregator)
+      gop_aggregator->flush();
+
+    if (archive)
+      archive->close(parser.get_sequence_info());
+
+    // the estimates are only complete after parsing, in an additional
+    // sequence_info record
+    if (summary || sample_gops > 0) {
+      json extensions = json::object();
+      if (aggregate)
+        extensions["aggregates"] =
+            aggregates_json(aggregator, &metric_selection);
+      if (quantiles)
+        extensions["quantiles"] = quantiles_json(field_quantiles);
+      if (feature_extractor)
+        extensions["p1204_features"] = p1204_features_json(
+            feature_extractor->get_features(parser.get_sequence_info()));
+      if (sample_gops > 0) {
+        videoparser::SequenceInfo sampled_info = parser.get_sequence_info();
+        extensions["gop_count"] = sampled_info.gop_count;
+        extensions["sampled_gop_count"] = sampled_info.sampled_gop_count;
+        extensions["estimates"] =
+            estimates_json(sampled_info, &metric_selection);
+      }
+      print_sequence_info_json(parser.get_sequence_info(), *output,
+                               extensions);
+    }
+
     parser.close();
+    output->close();
   } catch (const std::exception &e) {
     std::cerr << "Error: " << e.what() << std::endl;
     return EXIT_FAILURE;
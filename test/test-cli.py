@@ -1,7 +1,12 @@
 #!/usr/bin/env pytest
 
+import gzip
 import json
 import os
+import resource
+import shutil
+import signal
+import statistics
 import subprocess
 from typing import Dict, List
 
@@ -18,8 +23,10 @@ TEST_FILES = [
 ]
 
 
-def call_parser(video_file: str, num_frames: int = 2) -> tuple[List[Dict], Dict]:
-    """Call the video parser on the given video file and return frame info and sequence info."""
+def run_parser(
+    video_file: str, num_frames: int = 2, extra_args: tuple[str, ...] = ()
+) -> str:
+    """Call the video parser on the given video file and return its STDOUT."""
 
     # get stdout only
     output = subprocess.check_output(
@@ -28,15 +35,19 @@ def call_parser(video_file: str, num_frames: int = 2) -> tuple[List[Dict], Dict]
             video_file,
             "-n",  # number of frames to parse
             str(num_frames),
-        ],
+        ]
+        + list(extra_args),
         cwd=HERE,
     )
+    return output.decode("utf-8")
 
-    # parse the ldjson output
+
+def parse_output(output: str) -> tuple[List[Dict], Dict]:
+    """Split ldjson output into frame info and sequence info."""
     frame_info: List[Dict] = []
     sequence_info: Dict = {}
 
-    for line in output.decode("utf-8").splitlines():
+    for line in output.splitlines():
         json_line = json.loads(line)
         if json_line["type"] == "frame_info":
             frame_info.append(json_line)
@@ -46,6 +57,55 @@ def call_parser(video_file: str, num_frames: int = 2) -> tuple[List[Dict], Dict]
     return frame_info, sequence_info
 
 
+# legacy column names of the per-frame metrics in the P.1204.3 features
+P1204_COLUMNS = {
+    "Av_QP": "qp_avg",
+    "StdDev_QP": "qp_stdev",
+    "Av_QPBB": "qp_bb_avg",
+    "StdDev_QPBB": "qp_bb_stdev",
+    "min_QP": "qp_min",
+    "max_QP": "qp_max",
+    "InitialQP": "qp_init",
+    "Av_Motion": "motion_avg",
+    "StdDev_Motion": "motion_stdev",
+    "Av_MotionX": "motion_x_avg",
+    "StdDev_MotionX": "motion_x_stdev",
+    "Av_MotionY": "motion_y_avg",
+    "StdDev_MotionY": "motion_y_stdev",
+    "Av_MotionDif": "motion_diff_avg",
+    "StdDev_MotionDif": "motion_diff_stdev",
+    "BitCntMotion": "motion_bit_count",
+    "BitCntCoefs": "coefs_bit_count",
+    "NumBlksMv": "mb_mv_count",
+    "CodedMv": "mv_coded_count",
+    "FrameSize": "size",
+}
+
+
+def p1204_statistics(values: List[float]) -> Dict[str, float]:
+    """Compute the statistics of a column like numpy and scipy do by default:
+    population moments, and quartiles interpolated between the closest ranks."""
+    mean = statistics.fmean(values)
+    variance = statistics.pvariance(values, mean)
+    m3 = statistics.fmean([(v - mean) ** 3 for v in values])
+    m4 = statistics.fmean([(v - mean) ** 4 for v in values])
+    q1, _, q3 = statistics.quantiles(values, n=4, method="inclusive")
+    return {
+        "mean": mean,
+        "std": variance**0.5,
+        "min": min(values),
+        "max": max(values),
+        "skewness": m3 / variance**1.5 if variance > 0 else 0.0,
+        "kurtosis": m4 / variance**2 - 3 if variance > 0 else 0.0,
+        "iqr": q3 - q1,
+    }
+
+
+def call_parser(video_file: str, num_frames: int = 2) -> tuple[List[Dict], Dict]:
+    """Call the video parser on the given video file and return frame info and sequence info."""
+    return parse_output(run_parser(video_file, num_frames))
+
+
 class TestCLI:
     @pytest.mark.parametrize("test_file,expected_codec", TEST_FILES)
     def test_parser_cli(self, test_file: str, expected_codec: str):
@@ -86,3 +146,478 @@ class TestCLI:
 
         # Second frame should have frame_idx 1
         assert frame_info[1]["frame_idx"] == 1
+
+    def test_gzip_output(self, tmp_path):
+        video_file = os.path.join(HERE, "test-libx264.mp4")
+        output_file = tmp_path / "output.ldjson.gz"
+
+        stdout = run_parser(video_file, 10)
+        assert run_parser(video_file, 10, ("--output", str(output_file))) == ""
+
+        with gzip.open(output_file, "rt") as f:
+            assert f.read() == stdout
+
+    def test_gzip_output_write_error(self, tmp_path):
+        video_file = os.path.join(HERE, "test-libx264.mp4")
+        output_file = tmp_path / "output.ldjson.gz"
+
+        def limit_file_size():
+            # fail writes with EFBIG instead of killing the process
+            signal.signal(signal.SIGXFSZ, signal.SIG_IGN)
+            resource.setrlimit(resource.RLIMIT_FSIZE, (64, 64))
+
+        result = subprocess.run(
+            [
+                "../build/VideoParserCli/video-parser",
+                video_file,
+                "-n",
+                "-1",
+                "--output",
+                str(output_file),
+            ],
+            cwd=HERE,
+            capture_output=True,
+            text=True,
+            preexec_fn=limit_file_size,
+        )
+        assert result.returncode == 1
+        assert "Error writing gzip output" in result.stderr
+
+    @pytest.mark.parametrize("test_file,expected_codec", TEST_FILES)
+    def test_archive_roundtrip(self, tmp_path, test_file: str, expected_codec: str):
+        video_file = os.path.join(HERE, test_file)
+        archive_file = tmp_path / "output.vpa"
+
+        expected_frames, _ = parse_output(run_parser(video_file, 50))
+        run_parser(video_file, 50, ("--format", "archive", "-o", str(archive_file)))
+
+        frame_info, sequence_info = parse_output(
+            run_parser(str(archive_file), -1, ("--read-archive",))
+        )
+        assert sequence_info["video_codec"] == expected_codec
+        assert frame_info == expected_frames
+
+    def test_archive_missing_timestamps(self, tmp_path):
+        # the packets of a raw Annex B stream have no timestamps
+        video_file = os.path.join(HERE, "test-libx264.h264")
+        archive_file = tmp_path / "output.vpa"
+        extra_args = ("--mode", "packets")
+
+        expected_frames, _ = parse_output(run_parser(video_file, -1, extra_args))
+        assert any(frame["pts"] is None for frame in expected_frames)
+        archive_args = ("--format", "archive", "-o", str(archive_file))
+        run_parser(video_file, -1, extra_args + archive_args)
+
+        # the fields of the parse mode are printed as in the original output
+        frame_info, _ = parse_output(
+            run_parser(str(archive_file), -1, extra_args + ("--read-archive",))
+        )
+        assert frame_info == expected_frames
+
+    def test_metric_selection(self):
+        video_file = os.path.join(HERE, "test-libx264.mp4")
+        frame_info, _ = parse_output(
+            run_parser(video_file, 5, ("--metrics", "qp,size,frame_type"))
+        )
+        full_frame_info, _ = call_parser(video_file, 5)
+
+        qp_keys = {key for key in full_frame_info[0] if key.startswith("qp_")}
+        expected_keys = {"type", "frame_idx", "size", "frame_type"} | qp_keys
+        for frame, full_frame in zip(frame_info, full_frame_info):
+            assert set(frame.keys()) == expected_keys
+            for key in expected_keys:
+                assert frame[key] == full_frame[key]
+
+    def test_aggregate(self):
+        video_file = os.path.join(HERE, "test-libx264.mp4")
+        frame_info, sequence_info = parse_output(
+            run_parser(video_file, 20, ("--aggregate",))
+        )
+        full_frame_info, _ = call_parser(video_file, 20)
+
+        assert frame_info == []
+        aggregates = sequence_info["aggregates"]
+        assert aggregates["all"]["frame_count"] == 20
+
+        sizes = [frame["size"] for frame in full_frame_info]
+        assert aggregates["all"]["size"]["min"] == min(sizes)
+        assert aggregates["all"]["size"]["max"] == max(sizes)
+        assert aggregates["all"]["size"]["mean"] == pytest.approx(
+            sum(sizes) / len(sizes)
+        )
+
+        i_frames = [frame for frame in full_frame_info if frame["frame_type"] == 1]
+        assert aggregates["I"]["frame_count"] == len(i_frames)
+
+    def test_quantiles(self):
+        video_file = os.path.join(HERE, "test-libx264.mp4")
+        frame_info, sequence_info = parse_output(
+            run_parser(video_file, 20, ("--quantiles",))
+        )
+        full_frame_info, _ = call_parser(video_file, 20)
+
+        assert frame_info == []
+        assert "aggregates" not in sequence_info
+        quantiles = sequence_info["quantiles"]
+        assert set(quantiles.keys()) == {"qp_avg", "motion_avg", "size"}
+
+        sizes = [frame["size"] for frame in full_frame_info]
+        size_quantiles = quantiles["size"]
+        assert (
+            min(sizes)
+            <= size_quantiles["p5"]
+            <= size_quantiles["p50"]
+            <= size_quantiles["p95"]
+            <= size_quantiles["p99"]
+            <= max(sizes)
+        )
+
+    def test_window_and_gop_stats(self):
+        video_file = os.path.join(HERE, "test-libx264.mp4")
+        output = run_parser(video_file, -1, ("--window", "1,2", "--gop-stats"))
+        records = [json.loads(line) for line in output.splitlines()]
+        frame_info, _ = parse_output(output)
+
+        windows = [r for r in records if r["type"] == "window_info"]
+        assert {w["length"] for w in windows} == {1, 2}
+        for window in windows:
+            assert window["frame_count"] > 0
+            assert window["bitrate"] > 0
+            assert window["end"] - window["start"] <= window["length"] + 1e-9
+
+        gops = [r for r in records if r["type"] == "gop_info"]
+        assert len(gops) == len([f for f in frame_info if f["is_idr"]])
+        assert sum(gop["frame_count"] for gop in gops) == len(frame_info)
+
+    def test_p1204_features(self):
+        video_file = os.path.join(HERE, "test-libx264.mp4")
+        frame_info, sequence_info = parse_output(
+            run_parser(video_file, -1, ("--p1204-features",))
+        )
+        full_frame_info, _ = call_parser(video_file, -1)
+
+        assert frame_info == []
+        features = sequence_info["p1204_features"]
+        assert features["codec"] == "h264"
+        assert features["bitrate"] == sequence_info["video_bitrate"]
+
+        # the same features as derived from the per-frame records
+        non_i_frame_info = [f for f in full_frame_info if f["frame_type"] != 1]
+        expected = {}
+        for column, key in P1204_COLUMNS.items():
+            for suffix, frames in (("", full_frame_info), ("_non-i", non_i_frame_info)):
+                column_statistics = p1204_statistics([f[key] for f in frames])
+                for name, value in column_statistics.items():
+                    expected[f"{column}_{name}{suffix}"] = value
+        expected["quant"] = expected["Av_QP_mean_non-i"] / 51
+        sequence_features = {"bitrate", "framerate", "resolution", "bitdepth"}
+        assert set(features) == set(expected) | sequence_features | {
+            "codec",
+            "duration",
+        }
+        for name, value in expected.items():
+            assert features[name] == pytest.approx(value, rel=1e-9, abs=1e-9), name
+
+    def test_p1204_statistics(self):
+        # numpy.percentile, numpy.std, scipy.stats.skew and scipy.stats.kurtosis
+        values = p1204_statistics([1, 2, 3, 4, 10])
+        assert values["mean"] == 4
+        assert values["std"] == pytest.approx(10**0.5)
+        assert values["skewness"] == pytest.approx(1.1384199576606167)
+        assert values["kurtosis"] == pytest.approx(-0.212)
+        assert values["iqr"] == 2
+        assert p1204_statistics([1, 2, 3, 4])["iqr"] == 1.5
+
+    @pytest.mark.parametrize(
+        "test_file",
+        [
+            "test-libx264.mp4",
+            "test-libx265.mp4",
+            "test-libvpx-vp9.mp4",
+            "test-libaom-av1.mp4",
+        ],
+    )
+    def test_header_mode(self, test_file: str):
+        video_file = os.path.join(HERE, test_file)
+        frame_info, _ = parse_output(
+            run_parser(video_file, -1, ("--mode", "headers"))
+        )
+        full_frame_info, _ = parse_output(run_parser(video_file, -1))
+        assert len(frame_info) == len(full_frame_info)
+        assert "qp_avg" not in frame_info[0]
+        assert "motion_avg" not in frame_info[0]
+        assert frame_info[0]["is_idr"]
+
+        # header mode returns frames in decoding order, so match them by packet
+        header_by_dts = {frame["dts"]: frame for frame in frame_info}
+        assert len(header_by_dts) == len(frame_info)
+        keys = ["qp_init", "frame_type", "is_idr"]
+        if test_file in ("test-libx264.mp4", "test-libx265.mp4"):
+            keys.append("current_poc")
+        for full_frame in full_frame_info:
+            header_frame = header_by_dts[full_frame["dts"]]
+            for key in keys:
+                assert header_frame[key] == full_frame[key], (key, full_frame["dts"])
+
+    def test_packet_mode(self):
+        video_file = os.path.join(HERE, "test-libx264.mp4")
+        frame_info, sequence_info = parse_output(
+            run_parser(video_file, -1, ("--mode", "packets"))
+        )
+        header_frame_info, _ = parse_output(
+            run_parser(video_file, -1, ("--mode", "headers"))
+        )
+        assert [f["size"] for f in frame_info] == [
+            f["size"] for f in header_frame_info
+        ]
+        assert [f["is_idr"] for f in frame_info] == [
+            f["is_idr"] for f in header_frame_info
+        ]
+        assert "frame_type" not in frame_info[0]
+        assert "qp_init" not in frame_info[0]
+        assert sequence_info["video_frame_count"] == len(frame_info)
+
+    @pytest.mark.parametrize("test_file,expected_codec", TEST_FILES)
+    def test_packet_mode_sample_table(self, test_file: str, expected_codec: str):
+        video_file = os.path.join(HERE, test_file)
+        output = run_parser(video_file, -1, ("--mode", "packets"))
+        assert output == run_parser(
+            video_file, -1, ("--mode", "packets", "--no-sample-table")
+        )
+
+    def test_packet_mode_fragmented(self):
+        video_file = os.path.join(HERE, "test-libx264-frag.mp4")
+        # the samples come from the trun boxes and the defaults of trex, and
+        # match the fragments that the demuxer indexed
+        result = subprocess.run(
+            [
+                "../build/VideoParserCli/video-parser",
+                video_file,
+                "-n",
+                "-1",
+                "--mode",
+                "packets",
+                "--verbose",
+            ],
+            cwd=HERE,
+            capture_output=True,
+            check=True,
+        )
+        assert b"sample table" not in result.stderr
+        output = result.stdout.decode("utf-8")
+        assert output == run_parser(
+            video_file, -1, ("--mode", "packets", "--no-sample-table")
+        )
+
+        # the fragments hold the samples of the unfragmented file
+        frame_info, _ = parse_output(output)
+        unfragmented_frame_info, _ = parse_output(
+            run_parser(
+                os.path.join(HERE, "test-libx264.mp4"), -1, ("--mode", "packets")
+            )
+        )
+        keys = ("size", "is_idr")
+        assert [[f[k] for k in keys] for f in frame_info] == [
+            [f[k] for k in keys] for f in unfragmented_frame_info
+        ]
+
+    @pytest.mark.parametrize("test_file,expected_codec", TEST_FILES)
+    def test_keyframes_only(self, test_file: str, expected_codec: str):
+        video_file = os.path.join(HERE, test_file)
+        frame_info, sequence_info = parse_output(
+            run_parser(video_file, -1, ("--keyframes-only",))
+        )
+        full_frame_info, full_sequence_info = parse_output(run_parser(video_file, -1))
+        key_frames = [f for f in full_frame_info if f["is_idr"]]
+        assert [f["frame_idx"] for f in frame_info] == [
+            f["frame_idx"] for f in key_frames
+        ]
+        assert [f["qp_avg"] for f in frame_info] == [f["qp_avg"] for f in key_frames]
+        assert sequence_info["video_bitrate"] == full_sequence_info["video_bitrate"]
+
+    # streams without temporal layers have all pictures in layer 0
+    @pytest.mark.parametrize("test_file", ["test-libaom-av1.mp4", "test-libx265.mp4"])
+    def test_max_temporal_id(self, test_file: str):
+        video_file = os.path.join(HERE, test_file)
+        frame_info, sequence_info = parse_output(
+            run_parser(video_file, -1, ("--max-temporal-id", "0"))
+        )
+        full_frame_info, full_sequence_info = parse_output(run_parser(video_file, -1))
+        full_by_idx = {f["frame_idx"]: f for f in full_frame_info}
+        assert frame_info[0]["is_idr"]
+        for frame in frame_info:
+            assert frame == full_by_idx[frame["frame_idx"]]
+        assert sequence_info["video_bitrate"] == full_sequence_info["video_bitrate"]
+
+    def test_max_temporal_id_layers(self):
+        video_file = os.path.join(HERE, "test-libx265-temporal.mp4")
+        full_frame_info, full_sequence_info = parse_output(run_parser(video_file, -1))
+        # the derived video decodes to the same frames as the one it comes from
+        original_frame_info, _ = parse_output(
+            run_parser(os.path.join(HERE, "test-libx265.mp4"), -1)
+        )
+        assert full_frame_info == original_frame_info
+
+        frame_info, sequence_info = parse_output(
+            run_parser(video_file, -1, ("--max-temporal-id", "0"))
+        )
+        # 147 of the 300 pictures are in temporal layer 1
+        assert len(frame_info) == len(full_frame_info) - 147
+        full_by_idx = {f["frame_idx"]: f for f in full_frame_info}
+        for frame in frame_info:
+            full_frame = full_by_idx[frame["frame_idx"]]
+            assert frame["poc_diff"] == full_frame["poc_diff"]
+            assert frame["motion_avg"] == full_frame["motion_avg"]
+            assert frame == full_frame
+        assert sequence_info["video_bitrate"] == full_sequence_info["video_bitrate"]
+
+        all_layers, _ = parse_output(
+            run_parser(video_file, -1, ("--max-temporal-id", "1"))
+        )
+        assert all_layers == full_frame_info
+
+    def test_max_temporal_id_unsupported(self):
+        video_file = os.path.join(HERE, "test-libvpx-vp9.mp4")
+        with pytest.raises(subprocess.CalledProcessError):
+            run_parser(video_file, 2, ("--max-temporal-id", "0"))
+
+    @pytest.mark.parametrize("test_file,expected_codec", TEST_FILES)
+    def test_range_frames(self, test_file: str, expected_codec: str):
+        video_file = os.path.join(HERE, test_file)
+        full_frame_info, _ = parse_output(run_parser(video_file, -1))
+        frame_info, _ = parse_output(
+            run_parser(video_file, -1, ("--start", "10f", "--end", "20f"))
+        )
+        expected = [f for f in full_frame_info if 10 <= f["frame_idx"] < 20]
+        keys = ("frame_idx", "pts", "qp_avg")
+        assert [[f[k] for k in keys] for f in frame_info] == [
+            [f[k] for k in keys] for f in expected
+        ]
+
+        range_args = ("--start", "10f", "--end", "20f", "--aggregate")
+        _, sequence_info = parse_output(run_parser(video_file, -1, range_args))
+        assert sequence_info["video_frame_count"] == 10
+
+    def test_range_seconds(self):
+        video_file = os.path.join(HERE, "test-libx264.mp4")
+        full_frame_info, _ = parse_output(run_parser(video_file, -1))
+        start = full_frame_info[5]["pts"]
+        end = full_frame_info[15]["pts"]
+        frame_info, _ = parse_output(
+            run_parser(video_file, -1, ("--start", str(start), "--end", str(end)))
+        )
+        assert [f["frame_idx"] for f in frame_info] == list(range(5, 15))
+
+        packet_frame_info, _ = parse_output(
+            run_parser(
+                video_file,
+                -1,
+                ("--mode", "packets", "--start", str(start), "--end", str(end)),
+            )
+        )
+        assert sorted(f["pts"] for f in packet_frame_info) == [
+            f["pts"] for f in frame_info
+        ]
+
+    def test_write_index(self, tmp_path):
+        # MPEG-TS lists no packets, so the sidecar index is used
+        video_file = str(tmp_path / "test-libx264.ts")
+        shutil.copy(os.path.join(HERE, "test-libx264.ts"), video_file)
+        output = run_parser(video_file, -1, ("--write-index",))
+        assert os.path.getsize(video_file + ".vpidx") > 0
+        full_frame_info, _ = parse_output(output)
+        assert [f["frame_idx"] for f in full_frame_info] == list(range(300))
+        assert run_parser(video_file, -1) == output
+
+        # the range starts at the second key frame, frame 250, and the frame
+        # indices come from the index
+        keys = ("frame_idx", "pts", "frame_type", "size", "qp_avg")
+        frame_info, _ = parse_output(
+            run_parser(video_file, -1, ("--start", "255f", "--end", "270f"))
+        )
+        expected = [f for f in full_frame_info if 255 <= f["frame_idx"] < 270]
+        assert [[f[k] for k in keys] for f in frame_info] == [
+            [f[k] for k in keys] for f in expected
+        ]
+
+        frame_info, sequence_info = parse_output(
+            run_parser(video_file, -1, ("--sample-gops", "100000"))
+        )
+        assert sequence_info["gop_count"] == 2
+        assert sequence_info["sampled_gop_count"] == 2
+        assert sequence_info["video_frame_count"] == 300
+        assert [[f[k] for k in keys] for f in frame_info] == [
+            [f[k] for k in keys] for f in full_frame_info
+        ]
+
+    def test_outdated_index(self, tmp_path):
+        video_file = str(tmp_path / "test-libx264.ts")
+        shutil.copy(os.path.join(HERE, "test-libx264.ts"), video_file)
+        full_frame_info, _ = parse_output(
+            run_parser(video_file, -1, ("--write-index",))
+        )
+
+        # change the PCR extension of the first video packet: the frames stay
+        # the same, but the file does not match the index despite its size
+        with open(video_file, "r+b") as f:
+            data = bytearray(f.read())
+            first_video_packet = next(
+                pos
+                for pos in range(0, len(data), 188)
+                if (data[pos + 1] & 0x1F, data[pos + 2]) == (0x01, 0x00)
+            )
+            data[first_video_packet + 11] ^= 0x01
+            f.seek(0)
+            f.write(data)
+
+        result = subprocess.run(
+            ["../build/VideoParserCli/video-parser", video_file, "-n", "-1"],
+            cwd=HERE,
+            capture_output=True,
+            check=True,
+        )
+        assert b"does not match the file" in result.stderr
+        frame_info, _ = parse_output(result.stdout.decode("utf-8"))
+        assert frame_info == full_frame_info
+
+    def test_frame_at(self):
+        video_file = os.path.join(HERE, "test-libx264.mp4")
+        full_frame_info, _ = parse_output(run_parser(video_file, -1))
+        positions = f"12f,3f,13f,{full_frame_info[20]['pts']}"
+        frame_info, _ = parse_output(
+            run_parser(video_file, -1, ("--frame-at", positions))
+        )
+        assert [f["frame_idx"] for f in frame_info] == [12, 3, 13, 20]
+        for f in frame_info:
+            expected = full_frame_info[f["frame_idx"]]
+            assert f["pts"] == expected["pts"]
+            assert f["qp_avg"] == expected["qp_avg"]
+
+    def test_sample_gops(self):
+        video_file = os.path.join(HERE, "test-libx264.mp4")
+        args = ("--sample-gops", "2", "--sample-method", "random", "--sample-seed", "7")
+        output = run_parser(video_file, -1, args)
+        assert output == run_parser(video_file, -1, args)
+
+        frame_info, sequence_info = parse_output(output)
+        frame_indices = [f["frame_idx"] for f in frame_info]
+        assert frame_indices == sorted(set(frame_indices))
+        assert 1 <= sequence_info["sampled_gop_count"] <= 2
+        assert sequence_info["gop_count"] >= sequence_info["sampled_gop_count"]
+        assert "qp_avg" in sequence_info["estimates"]
+        assert "frame_idx" not in sequence_info["estimates"]
+
+    def test_sample_all_gops(self):
+        video_file = os.path.join(HERE, "test-libx264.mp4")
+        frame_info, sequence_info = parse_output(
+            run_parser(video_file, -1, ("--sample-gops", "100000"))
+        )
+        assert sequence_info["sampled_gop_count"] == sequence_info["gop_count"]
+
+        # all GOPs sampled: the estimate is the exact mean
+        mean = sum(f["qp_avg"] for f in frame_info) / len(frame_info)
+        estimate = sequence_info["estimates"]["qp_avg"]
+        assert estimate["mean"] == pytest.approx(mean)
+        if sequence_info["gop_count"] > 1:
+            assert estimate["ci_lower"] == pytest.approx(mean)
+            assert estimate["ci_upper"] == pytest.approx(mean)
@@ -105,6 +105,11 @@ if [[ ! -f config.h ]] || [[ "$reconfigure" = true ]]; then
     --disable-muxers
     --disable-outdevs
     --disable-bsfs
+    # the *_metadata filters pull in the coded bitstream readers (CBS) that the
+    # header-only parse mode uses; AV1's is already part of the AV1 parser
+    --enable-bsf=h264_metadata
+    --enable-bsf=hevc_metadata
+    --enable-bsf=vp9_metadata
     # disable all but file protocol
     --disable-indevs
     --disable-protocols
@@ -0,0 +1,631 @@
+#!/usr/bin/env python3
+"""
+Derive test videos with stream features that the encoder defaults of
+generate-test.videos.sh do not produce, by rewriting the headers and boxes of
+the generated test videos. The pictures are not re-encoded, so the derived
+videos decode to the same frames as the videos they come from:
+
+- test-libx265-temporal.mp4: test-libx265.mp4 with its sub-layer non-reference
+  pictures (TRAIL_N, RASL_N) moved to temporal layer 1. No picture references
+  them, so the pictures of layer 0 decode exactly as before. The VPS and SPS
+  are rewritten for two sub-layers.
+- test-libx264.ts: test-libx264.mp4 in an MPEG-TS, which lists no packets, for
+  the sidecar index. Each access unit is one PES packet, with an access unit
+  delimiter, and the parameter sets, PAT and PMT before each key frame.
+- test-libx264.h264: test-libx264.mp4 as a raw Annex B stream, with the same
+  access units as test-libx264.ts. Its packets have no timestamps.
+- test-libx264-frag.mp4: test-libx264.mp4 as a fragmented MP4, for the sample
+  tables of movie fragments. The moov box has empty sample tables, and each
+  fragment of up to 60 samples, or from a key frame on, has one trun box with
+  the sample sizes and composition offsets; the durations and the flags of the
+  frames other than key frames come from the defaults of the trex box.
+
+The script only needs the Python standard library, and produces the same files
+on every run.
+"""
+
+import os
+import struct
+from typing import Callable, Dict, Iterator, List, NamedTuple, Optional, Tuple
+
+HERE = os.path.dirname(os.path.realpath(__file__))
+TEST_DIR = os.path.join(HERE, "..", "test")
+
+# bytes before the first child of boxes that contain fields and boxes
+CHILD_OFFSETS = {"stsd": 8, "avc1": 78, "hev1": 78, "hvc1": 78}
+
+# HEVC NAL unit types of sub-layer non-reference pictures
+HEVC_SUB_LAYER_NON_REFERENCE = {0, 2, 4, 6, 8, 10, 12, 14}
+HEVC_VPS = 32
+HEVC_SPS = 33
+
+
+def read_file(name: str) -> bytes:
+    with open(os.path.join(TEST_DIR, name), "rb") as f:
+        return f.read()
+
+
+def write_file(name: str, data: bytes) -> None:
+    with open(os.path.join(TEST_DIR, name), "wb") as f:
+        f.write(data)
+    print(f"Wrote {name}")
+
+
+def boxes(data: bytes, start: int, end: int) -> Iterator[Tuple[str, int, int, int]]:
+    """Yield the type, start, content start and end of the boxes in a range."""
+    pos = start
+    while pos + 8 <= end:
+        size, box_type = struct.unpack(">I4s", data[pos : pos + 8])
+        header = 8
+        if size == 1:
+            size = struct.unpack(">Q", data[pos + 8 : pos + 16])[0]
+            header = 16
+        elif size == 0:
+            size = end - pos
+        yield box_type.decode("latin-1"), pos, pos + header, pos + size
+        pos += size
+
+
+def find_box(data: bytes, path: List[str], start: int = 0, end: int = -1) -> bytes:
+    """Return the content of the first box at a path of box types."""
+    if end < 0:
+        end = len(data)
+    for box_type, _, content_start, box_end in boxes(data, start, end):
+        if box_type != path[0]:
+            continue
+        if len(path) == 1:
+            return data[content_start:box_end]
+        content_start += CHILD_OFFSETS.get(box_type, 0)
+        return find_box(data, path[1:], content_start, box_end)
+    raise ValueError(f"No {path[0]} box")
+
+
+def make_box(box_type: str, content: bytes) -> bytes:
+    return struct.pack(">I4s", 8 + len(content), box_type.encode()) + content
+
+
+def replace_box(
+    data: bytes, path: List[str], replace: Callable[[bytes], bytes]
+) -> bytes:
+    """Replace the content of the box at a path, and fix the parent sizes."""
+    out = b""
+    for box_type, _, content_start, box_end in boxes(data, 0, len(data)):
+        content = data[content_start:box_end]
+        if box_type == path[0]:
+            if len(path) == 1:
+                content = replace(content)
+            else:
+                offset = CHILD_OFFSETS.get(box_type, 0)
+                content = content[:offset] + replace_box(
+                    content[offset:], path[1:], replace
+                )
+        out += make_box(box_type, content)
+    return out
+
+
+def full_box_entries(content: bytes, fmt: str) -> List[Tuple[int, ...]]:
+    """Read the entries of a table box with a version, flags and entry count."""
+    count = struct.unpack(">I", content[4:8])[0]
+    size = struct.calcsize(fmt)
+    return [
+        struct.unpack(fmt, content[8 + i * size : 8 + (i + 1) * size])
+        for i in range(count)
+    ]
+
+
+class Sample(NamedTuple):
+    offset: int
+    size: int
+    dts: int
+    composition_offset: int
+    is_sync: bool
+
+
+def read_samples(data: bytes) -> List[Sample]:
+    """Read the samples of the first track from its sample table."""
+    stbl = find_box(data, ["moov", "trak", "mdia", "minf", "stbl"])
+    stsz = find_box(stbl, ["stsz"])
+    sample_size, count = struct.unpack(">II", stsz[4:12])
+    if sample_size:
+        sizes = [sample_size] * count
+    else:
+        sizes = list(struct.unpack(f">{count}I", stsz[12 : 12 + 4 * count]))
+    chunk_offsets = [
+        entry[0] for entry in full_box_entries(find_box(stbl, ["stco"]), ">I")
+    ]
+    chunks = full_box_entries(find_box(stbl, ["stsc"]), ">III")
+
+    offsets = []
+    for chunk_idx, offset in enumerate(chunk_offsets):
+        samples_per_chunk = [
+            per_chunk for first, per_chunk, _ in chunks if chunk_idx + 1 >= first
+        ][-1]
+        for _ in range(samples_per_chunk):
+            offsets.append(offset)
+            offset += sizes[len(offsets) - 1]
+
+    dts = [0]
+    for sample_count, delta in full_box_entries(find_box(stbl, ["stts"]), ">II"):
+        for _ in range(sample_count):
+            dts.append(dts[-1] + delta)
+    composition_offsets = []
+    for sample_count, composition_offset in full_box_entries(
+        find_box(stbl, ["ctts"]), ">Ii"
+    ):
+        composition_offsets += [composition_offset] * sample_count
+    sync = {entry[0] - 1 for entry in full_box_entries(find_box(stbl, ["stss"]), ">I")}
+
+    return [
+        Sample(offsets[i], sizes[i], dts[i], composition_offsets[i], i in sync)
+        for i in range(count)
+    ]
+
+
+def track_timescale(data: bytes) -> int:
+    mdhd = find_box(data, ["moov", "trak", "mdia", "mdhd"])
+    if mdhd[0] == 1:
+        return struct.unpack(">I", mdhd[20:24])[0]
+    return struct.unpack(">I", mdhd[12:16])[0]
+
+
+def nal_units(sample: bytes, length_size: int = 4) -> Iterator[Tuple[int, int]]:
+    """Yield the offset and size of the length-prefixed NAL units of a sample."""
+    pos = 0
+    while pos < len(sample):
+        size = int.from_bytes(sample[pos : pos + length_size], "big")
+        pos += length_size
+        yield pos, size
+        pos += size
+
+
+def unescape_rbsp(nal: bytes) -> bytes:
+    """Remove the emulation prevention bytes of a NAL unit."""
+    out = bytearray()
+    zeros = 0
+    for byte in nal:
+        if zeros >= 2 and byte == 3:
+            zeros = 0
+            continue
+        out.append(byte)
+        zeros = zeros + 1 if byte == 0 else 0
+    return bytes(out)
+
+
+def escape_rbsp(rbsp: bytes) -> bytes:
+    """Insert the emulation prevention bytes of a NAL unit."""
+    out = bytearray()
+    zeros = 0
+    for byte in rbsp:
+        if zeros >= 2 and byte <= 3:
+            out.append(3)
+            zeros = 0
+        out.append(byte)
+        zeros = zeros + 1 if byte == 0 else 0
+    return bytes(out)
+
+
+class BitReader:
+    def __init__(self, data: bytes, pos: int = 0):
+        self.data = data
+        self.pos = pos
+
+    def u(self, bits: int) -> int:
+        value = 0
+        for _ in range(bits):
+            byte = self.data[self.pos // 8]
+            value = (value << 1) | ((byte >> (7 - self.pos % 8)) & 1)
+            self.pos += 1
+        return value
+
+    def ue(self) -> int:
+        leading_zeros = 0
+        while self.u(1) == 0:
+            leading_zeros += 1
+        return (1 << leading_zeros) - 1 + self.u(leading_zeros)
+
+
+def clear_bit(data: bytearray, pos: int) -> None:
+    data[pos // 8] &= ~(0x80 >> (pos % 8)) & 0xFF
+
+
+# The VPS and SPS of a single sub-layer differ from those of two sub-layers in
+# the max_sub_layers_minus1 field, the sub-layer flags of profile_tier_level(),
+# which follow the byte-aligned general profile and level, and the
+# sub-layer ordering info. With sub_layer_ordering_info_present_flag set to 0,
+# the ordering info of the highest sub-layer is the only one, as before.
+
+# bytes of the general profile and level in profile_tier_level()
+HEVC_GENERAL_PTL_SIZE = 12
+# sub_layer_profile_present_flag, sub_layer_level_present_flag and the
+# reserved_zero_2bits up to 8 sub-layers, for two sub-layers without sub-layer
+# profile and level
+HEVC_SUB_LAYER_PTL = b"\x00\x00"
+
+
+def two_sub_layer_vps(nal: bytes) -> bytes:
+    rbsp = bytearray(unescape_rbsp(nal))
+    # vps_max_sub_layers_minus1 = 1, vps_temporal_id_nesting_flag = 1
+    rbsp[3] = (rbsp[3] & 0xF0) | 0x03
+    ptl_end = 6 + HEVC_GENERAL_PTL_SIZE
+    rbsp[ptl_end:ptl_end] = HEVC_SUB_LAYER_PTL
+    ordering_info_flag = (ptl_end + len(HEVC_SUB_LAYER_PTL)) * 8
+    clear_bit(rbsp, ordering_info_flag)
+
+    # without HRD parameters, the rest of the VPS does not depend on the number
+    # of sub-layers
+    reader = BitReader(rbsp, ordering_info_flag + 1)
+    for _ in range(3):
+        reader.ue()
+    max_layer_id = reader.u(6)
+    num_layer_sets = reader.ue() + 1
+    reader.u((num_layer_sets - 1) * (max_layer_id + 1))
+    if reader.u(1):
+        reader.u(64)
+        if reader.u(1):
+            reader.ue()
+        if reader.ue() != 0:
+            raise ValueError("VPS has HRD parameters")
+    return escape_rbsp(bytes(rbsp))
+
+
+def two_sub_layer_sps(nal: bytes) -> bytes:
+    rbsp = bytearray(unescape_rbsp(nal))
+    # sps_max_sub_layers_minus1 = 1, sps_temporal_id_nesting_flag = 1
+    rbsp[2] = (rbsp[2] & 0xF0) | 0x03
+    ptl_end = 3 + HEVC_GENERAL_PTL_SIZE
+    rbsp[ptl_end:ptl_end] = HEVC_SUB_LAYER_PTL
+
+    reader = BitReader(rbsp, (ptl_end + len(HEVC_SUB_LAYER_PTL)) * 8)
+    reader.ue()  # sps_seq_parameter_set_id
+    if reader.ue() == 3:  # chroma_format_idc
+        reader.u(1)
+    reader.ue()
+    reader.ue()
+    if reader.u(1):  # conformance_window_flag
+        for _ in range(4):
+            reader.ue()
+    for _ in range(3):
+        reader.ue()
+    clear_bit(rbsp, reader.pos)
+    # the rest only depends on the number of sub-layers with VUI HRD
+    # parameters, which x265 only writes with --hrd
+    return escape_rbsp(bytes(rbsp))
+
+
+def derive_hevc_temporal_layers() -> None:
+    data = bytearray(read_file("test-libx265.mp4"))
+
+    # the chunk offsets stay valid as long as the media data comes first
+    top_level = {
+        box_type: (start, end) for box_type, start, _, end in boxes(data, 0, len(data))
+    }
+    moov_start = top_level["moov"][0]
+    if moov_start < top_level["mdat"][1]:
+        raise ValueError("moov box precedes the media data")
+
+    for sample in read_samples(data):
+        sample_data = data[sample.offset : sample.offset + sample.size]
+        for nal_offset, _ in nal_units(sample_data):
+            header = sample.offset + nal_offset
+            if (data[header] >> 1) & 0x3F in HEVC_SUB_LAYER_NON_REFERENCE:
+                # nuh_temporal_id_plus1 = 2
+                data[header + 1] = (data[header + 1] & 0xF8) | 0x02
+
+    def rewrite_hvcc(hvcc: bytes) -> bytes:
+        # numTemporalLayers = 2, temporalIdNested = 1
+        out = bytearray(hvcc[:22])
+        out[21] = (out[21] & 0xC3) | (2 << 3) | (1 << 2)
+        out.append(hvcc[22])
+        pos = 23
+        for _ in range(hvcc[22]):
+            nal_type = hvcc[pos] & 0x3F
+            count = struct.unpack(">H", hvcc[pos + 1 : pos + 3])[0]
+            out += hvcc[pos : pos + 3]
+            pos += 3
+            for _ in range(count):
+                size = struct.unpack(">H", hvcc[pos : pos + 2])[0]
+                nal = hvcc[pos + 2 : pos + 2 + size]
+                pos += 2 + size
+                if nal_type == HEVC_VPS:
+                    nal = two_sub_layer_vps(nal)
+                elif nal_type == HEVC_SPS:
+                    nal = two_sub_layer_sps(nal)
+                out += struct.pack(">H", len(nal)) + nal
+        return bytes(out)
+
+    moov = replace_box(
+        bytes(data[moov_start:]),
+        ["moov", "trak", "mdia", "minf", "stbl", "stsd", "hev1", "hvcC"],
+        rewrite_hvcc,
+    )
+    write_file("test-libx265-temporal.mp4", bytes(data[:moov_start]) + moov)
+
+
+TS_PACKET_SIZE = 188
+TS_PAT_PID = 0x0000
+TS_PMT_PID = 0x1000
+TS_VIDEO_PID = 0x0100
+TS_STREAM_TYPE_H264 = 0x1B
+TS_CLOCK = 90000
+# timestamps of the first packet, and the delay of the PCR before the DTS
+TS_START = TS_CLOCK
+TS_PCR_DELAY = TS_CLOCK // 10
+
+H264_AUD = b"\x00\x00\x00\x01\x09\xf0"
+START_CODE = b"\x00\x00\x00\x01"
+
+
+def crc32_mpeg2(data: bytes) -> int:
+    crc = 0xFFFFFFFF
+    for byte in data:
+        crc ^= byte << 24
+        for _ in range(8):
+            crc = (crc << 1) ^ 0x04C11DB7 if crc & 0x80000000 else crc << 1
+            crc &= 0xFFFFFFFF
+    return crc
+
+
+def psi_section(table_id: int, body: bytes) -> bytes:
+    """Return a PSI section of program 1, with the syntax of the PAT and PMT."""
+    # section_length counts the bytes after it, including the CRC
+    section = struct.pack(
+        ">BHHBBB", table_id, 0xB000 | (5 + len(body) + 4), 1, 0xC1, 0, 0
+    )
+    section += body
+    return section + struct.pack(">I", crc32_mpeg2(section))
+
+
+def psi_payload(section: bytes) -> bytes:
+    """Return the payload of a packet with a PSI section: a pointer field of
+    0, the section and stuffing bytes."""
+    return (b"\x00" + section).ljust(TS_PACKET_SIZE - 4, b"\xff")
+
+
+def ts_packets(
+    pid: int,
+    payload: bytes,
+    continuity: Dict[int, int],
+    pcr_base: Optional[int] = None,
+    random_access: bool = False,
+) -> bytes:
+    """Split a PES packet or PSI payload into transport stream packets.
+
+    The first packet carries the PCR and random access indicator, if any. The
+    last packet is filled up with adaptation field stuffing.
+    """
+    out = b""
+    pos = 0
+    while pos == 0 or pos < len(payload):
+        adaptation = None
+        if pos == 0 and (pcr_base is not None or random_access):
+            flags = 0x40 if random_access else 0
+            adaptation = b""
+            if pcr_base is not None:
+                flags |= 0x10
+                adaptation = struct.pack(
+                    ">IH", pcr_base >> 1, ((pcr_base & 1) << 15) | 0x7E00
+                )
+            adaptation = bytes([flags]) + adaptation
+        space = TS_PACKET_SIZE - 4
+        if adaptation is not None:
+            space -= 1 + len(adaptation)
+        chunk = payload[pos : pos + space]
+        stuffing = space - len(chunk)
+        if stuffing and adaptation is None:
+            # the length of the adaptation field takes one byte, and its flags
+            # another, if there is room
+            stuffing -= 1
+            adaptation = b"\x00" if stuffing else b""
+            stuffing = max(stuffing - 1, 0)
+        adaptation_field = b""
+        if adaptation is not None:
+            adaptation += b"\xff" * stuffing
+            adaptation_field = bytes([len(adaptation)]) + adaptation
+
+        counter = continuity.get(pid, 0)
+        continuity[pid] = (counter + 1) & 0x0F
+        header = struct.pack(
+            ">BHB",
+            0x47,
+            (0x4000 if pos == 0 else 0) | pid,
+            (0x30 if adaptation_field else 0x10) | counter,
+        )
+        out += header + adaptation_field + chunk
+        pos += len(chunk)
+    return out
+
+
+def pes_timestamp(prefix: int, timestamp: int) -> bytes:
+    return bytes(
+        [
+            (prefix << 4) | ((timestamp >> 29) & 0x0E) | 1,
+            (timestamp >> 22) & 0xFF,
+            ((timestamp >> 14) & 0xFE) | 1,
+            (timestamp >> 7) & 0xFF,
+            ((timestamp << 1) & 0xFE) | 1,
+        ]
+    )
+
+
+def h264_access_units(data: bytes) -> Iterator[Tuple[Sample, bytes]]:
+    """
+    Yield the samples of an H.264 MP4 as Annex B access units, each starting
+    with an access unit delimiter, and with the parameter sets before each key
+    frame.
+    """
+    avcc = find_box(
+        data, ["moov", "trak", "mdia", "minf", "stbl", "stsd", "avc1", "avcC"]
+    )
+    length_size = (avcc[4] & 0x03) + 1
+    parameter_sets = b""
+    pos = 6
+    for count_mask in (0x1F, 0xFF):
+        for _ in range(avcc[pos - 1] & count_mask):
+            size = struct.unpack(">H", avcc[pos : pos + 2])[0]
+            parameter_sets += START_CODE + avcc[pos + 2 : pos + 2 + size]
+            pos += 2 + size
+        pos += 1
+
+    for sample in read_samples(data):
+        access_unit = H264_AUD
+        if sample.is_sync:
+            access_unit += parameter_sets
+        sample_data = data[sample.offset : sample.offset + sample.size]
+        for nal_offset, size in nal_units(sample_data, length_size):
+            access_unit += START_CODE + sample_data[nal_offset : nal_offset + size]
+        yield sample, access_unit
+
+
+def derive_h264_transport_stream() -> None:
+    data = read_file("test-libx264.mp4")
+    timescale = track_timescale(data)
+
+    def ticks(value: int) -> int:
+        if value * TS_CLOCK % timescale:
+            raise ValueError("Timestamp is not a multiple of the 90 kHz clock")
+        return value * TS_CLOCK // timescale
+
+    # program 1 with the PMT, and the video stream that also carries the PCR
+    pat = psi_section(0x00, struct.pack(">HH", 1, 0xE000 | TS_PMT_PID))
+    pmt = psi_section(
+        0x02,
+        struct.pack(">HH", 0xE000 | TS_VIDEO_PID, 0xF000)
+        + struct.pack(">BHH", TS_STREAM_TYPE_H264, 0xE000 | TS_VIDEO_PID, 0xF000),
+    )
+
+    continuity: Dict[int, int] = {}
+    out = b""
+    # one access unit per PES packet
+    for sample, access_unit in h264_access_units(data):
+        if sample.is_sync:
+            # the tables are repeated at each key frame, to start decoding there
+            out += ts_packets(TS_PAT_PID, psi_payload(pat), continuity)
+            out += ts_packets(TS_PMT_PID, psi_payload(pmt), continuity)
+
+        dts = TS_START + ticks(sample.dts)
+        pts = dts + ticks(sample.composition_offset)
+        # video stream 0xE0 of unbounded length, aligned to the access unit,
+        # with PTS and DTS
+        pes = (
+            b"\x00\x00\x01\xe0\x00\x00\x84\xc0\x0a"
+            + pes_timestamp(0x3, pts)
+            + pes_timestamp(0x1, dts)
+            + access_unit
+        )
+        out += ts_packets(
+            TS_VIDEO_PID, pes, continuity, dts - TS_PCR_DELAY, sample.is_sync
+        )
+    write_file("test-libx264.ts", out)
+
+
+def derive_h264_annex_b() -> None:
+    data = read_file("test-libx264.mp4")
+    write_file(
+        "test-libx264.h264",
+        b"".join(access_unit for _, access_unit in h264_access_units(data)),
+    )
+
+
+# sample flags (ISO/IEC 14496-12, 8.8.3.1) of key frames and of the others
+SAMPLE_DEPENDS_NO = 0x02000000
+SAMPLE_DEPENDS_YES_NON_SYNC = 0x01010000
+# samples per movie fragment, which also starts at each key frame
+FRAGMENT_SAMPLES = 60
+
+
+def full_box(
+    box_type: str, content: bytes, version: int = 0, flags: int = 0
+) -> bytes:
+    return make_box(box_type, struct.pack(">I", (version << 24) | flags) + content)
+
+
+def derive_h264_fragmented() -> None:
+    data = read_file("test-libx264.mp4")
+    samples = read_samples(data)
+    tkhd = find_box(data, ["moov", "trak", "tkhd"])
+    track_id = struct.unpack(">I", tkhd[12:16] if tkhd[0] == 0 else tkhd[20:24])[0]
+    duration = samples[1].dts - samples[0].dts
+    if any(b.dts - a.dts != duration for a, b in zip(samples, samples[1:])):
+        raise ValueError("Samples do not have a constant duration")
+
+    # the moov box keeps the sample description and edit list, with empty
+    # sample tables, and the defaults of the fragments
+    def empty_sample_table(stbl: bytes) -> bytes:
+        return (
+            make_box("stsd", find_box(stbl, ["stsd"]))
+            + full_box("stts", struct.pack(">I", 0))
+            + full_box("stsc", struct.pack(">I", 0))
+            + full_box("stsz", struct.pack(">II", 0, 0))
+            + full_box("stco", struct.pack(">I", 0))
+        )
+
+    trex = full_box(
+        "trex",
+        struct.pack(">IIIII", track_id, 1, duration, 0, SAMPLE_DEPENDS_YES_NON_SYNC),
+    )
+    moov = make_box("moov", find_box(data, ["moov"]))
+    moov = replace_box(
+        moov, ["moov", "trak", "mdia", "minf", "stbl"], empty_sample_table
+    )
+    moov = replace_box(
+        moov, ["moov"], lambda content: content + make_box("mvex", trex)
+    )
+    out = make_box("ftyp", find_box(data, ["ftyp"])) + moov
+
+    fragments: List[List[Sample]] = []
+    for sample in samples:
+        if sample.is_sync or len(fragments[-1]) == FRAGMENT_SAMPLES:
+            fragments.append([])
+        fragments[-1].append(sample)
+
+    for sequence_number, fragment in enumerate(fragments, 1):
+        # the durations and the flags of all but a key frame at the start
+        # come from trex
+        trun_flags = 0x000001 | 0x000200 | 0x000800
+        first_sample_flags = b""
+        if fragment[0].is_sync:
+            trun_flags |= 0x000004
+            first_sample_flags = struct.pack(">I", SAMPLE_DEPENDS_NO)
+        entries = b"".join(
+            struct.pack(">Ii", sample.size, sample.composition_offset)
+            for sample in fragment
+        )
+
+        def moof(data_offset: int) -> bytes:
+            trun = full_box(
+                "trun",
+                struct.pack(">Ii", len(fragment), data_offset)
+                + first_sample_flags
+                + entries,
+                flags=trun_flags,
+            )
+            traf = (
+                # default-base-is-moof
+                full_box("tfhd", struct.pack(">I", track_id), flags=0x020000)
+                + full_box("tfdt", struct.pack(">Q", fragment[0].dts), version=1)
+                + trun
+            )
+            return make_box(
+                "moof",
+                full_box("mfhd", struct.pack(">I", sequence_number))
+                + make_box("traf", traf),
+            )
+
+        # the data offset counts from the start of the moof box to the samples
+        data_offset = len(moof(0)) + 8
+        mdat = b"".join(
+            data[sample.offset : sample.offset + sample.size] for sample in fragment
+        )
+        out += moof(data_offset) + make_box("mdat", mdat)
+    write_file("test-libx264-frag.mp4", out)
+
+
+def main() -> None:
+    derive_hevc_temporal_layers()
+    derive_h264_transport_stream()
+    derive_h264_annex_b()
+    derive_h264_fragmented()
+
+
+if __name__ == "__main__":
+    main()
@@ -17,4 +17,6 @@ for encoder in libx264 libx265 libvpx-vp9 libaom-av1; do
     "test-$encoder.mp4"
 done
 
+../util/derive-test-videos.py
+
 echo "Done"